@@ -0,0 +1,59 @@
+// Mede o custo de uma troca de processo no escalonador (tira o primeiro
+// pronto e coloca de volta no fim), com cada vez mais processos na fila.
+// Com a fila intrusiva o custo tem que ficar constante, independente do
+// número de processos.
+// Uso: "make bench" (compila com -O2 e executa).
+
+#include "processos.h"
+#include "escalonador.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TROCAS 2000000
+
+static double mede_trocas(escalonador_t* esc, int n_processos)
+{
+    processo** processos = malloc(n_processos * sizeof(processo*));
+    for (int i = 0; i < n_processos; i++)
+    {
+        processos[i] = cria_processo(0, 0, 0, ERR_OK, 0, usuario, READY, i + 1, 0);
+        escalonador_enfila_processo(processos[i], esc);
+    }
+
+    struct timespec inicio, fim;
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+    for (long t = 0; t < TROCAS; t++)
+        escalonador_enfila_processo(escalonador_desenfila_processo(esc), esc);
+    clock_gettime(CLOCK_MONOTONIC, &fim);
+
+    for (int i = 0; i < n_processos; i++)
+    {
+        escalonador_remove_processo(processos[i], esc);
+        mata_processo(processos[i]);
+    }
+    free(processos);
+
+    double ns = (fim.tv_sec - inicio.tv_sec) * 1e9 + (fim.tv_nsec - inicio.tv_nsec);
+    return ns / TROCAS;
+}
+
+int main(void)
+{
+    int n_processos[] = { 10, 100, 1000, 10000 };
+    int quanta[] = { 10, 20, 40 };
+
+    printf("processos   round-robin          mlfq  (ns por troca)\n");
+    for (int i = 0; i < 4; i++)
+    {
+        escalonador_t* rr = escalonador_cria(10);
+        escalonador_t* mlfq = escalonador_cria_mlfq(3, quanta, 0);
+        double t_rr = mede_trocas(rr, n_processos[i]);
+        double t_mlfq = mede_trocas(mlfq, n_processos[i]);
+        printf("%9d %13.1f %13.1f\n", n_processos[i], t_rr, t_mlfq);
+        escalonador_destroi(rr);
+        escalonador_destroi(mlfq);
+    }
+    return 0;
+}
@@ -9,92 +9,302 @@
 #include <stdbool.h>
 #include <stdio.h>
 
-static no_processo* cria_no(processo* p);
-static void libera_no(no_processo* no_p);
-static no_processo* fila_acha_fim(fila_processos* f);
+static void fila_insere_fim(fila_processos* f, processo* p);
+static processo* fila_retira_inicio(fila_processos* f);
+static void fila_remove(fila_processos* f, processo* p);
 
-escalonador_t* escalonador_cria()
+static void atualiza_nivel(processo* p, escalonador_t* esc);
+static float restante(processo* p, escalonador_t* esc);
+static void fila_insere_ordenado(fila_processos* f, processo* p, escalonador_t* esc);
+
+escalonador_t* escalonador_cria(int quantum)
+{
+    // Round-robin é um MLFQ de um nível só, sem boost.
+    escalonador_t* esc = escalonador_cria_mlfq(1, &quantum, 0);
+    esc->politica = POLITICA_RR;
+
+    return esc;
+}
+
+escalonador_t* escalonador_cria_mlfq(int n_niveis, const int quanta[], int periodo_boost)
 {
     escalonador_t* esc = malloc(sizeof(escalonador_t));
-    esc->fila_prontos = malloc(sizeof(fila_processos));
-    esc->fila_prontos->raiz = NULL;
-
-    /*
-        int i;
-        esc->fila_prontos->raiz = NULL;
-        for(i = 0; i < numero_processos; i++)
-        {
-            if(processos[i] != NULL)
-            {
-                if(processos[i]->estado_processo == READY)
-                    escalonador_enfila_processo(f, esc);
-            }
-        }
-    */
+    esc->politica = POLITICA_MLFQ;
+    esc->n_niveis = n_niveis;
+    esc->quanta = malloc(n_niveis * sizeof(int));
+    esc->filas_prontos = malloc(n_niveis * sizeof(fila_processos));
+    for(int i = 0; i < n_niveis; i++)
+    {
+        esc->quanta[i] = quanta[i];
+        fila_inicializa(&esc->filas_prontos[i]);
+    }
+    esc->periodo_boost = periodo_boost;
+    esc->tempo_ate_boost = periodo_boost;
+    esc->epoca_boost = 0;
+    esc->alfa = 0;
+    esc->estimativa_inicial = 0;
 
     return esc;
 }
 
+escalonador_t* escalonador_cria_srt(int quantum, float alfa, float estimativa_inicial)
+{
+    // Um nível só, como o round-robin, mas a fila é ordenada pelo que falta de rajada.
+    // O quantum continua valendo, pra estimativa ser atualizada também de quem não bloqueia.
+    escalonador_t* esc = escalonador_cria_mlfq(1, &quantum, 0);
+    esc->politica = POLITICA_SRT;
+    esc->alfa = alfa;
+    esc->estimativa_inicial = estimativa_inicial;
+
+    return esc;
+}
+
+char* escalonador_nome(escalonador_t* esc)
+{
+    switch(esc->politica)
+    {
+        case POLITICA_RR:
+            return "round-robin";
+        case POLITICA_MLFQ:
+            return "mlfq";
+        case POLITICA_SRT:
+            return "srt";
+    }
+    return "?";
+}
+
+void escalonador_destroi(escalonador_t* esc)
+{
+    // Os processos não são da fila, só desliga eles dela.
+    for(int i = 0; i < esc->n_niveis; i++)
+    {
+        while(fila_retira_inicio(&esc->filas_prontos[i]) != NULL);
+    }
+    free(esc->filas_prontos);
+    free(esc->quanta);
+    free(esc);
+}
+
 void escalonador_enfila_processo(processo* p, escalonador_t* esc)
 {
-    
-    if(esc->fila_prontos->raiz == NULL)
-        esc->fila_prontos->raiz = cria_no(p);
-    else
+    atualiza_nivel(p, esc);
+    if(esc->politica == POLITICA_SRT)
     {
-        no_processo* ultimo_no = fila_acha_fim(esc->fila_prontos);
-        ultimo_no->proximo_no = cria_no(p);
+        if(p->fila != NULL)
+            fila_remove(p->fila, p);
+        fila_insere_ordenado(&esc->filas_prontos[0], p, esc);
+        return;
     }
+    escalonador_bloqueia_processo(p, &esc->filas_prontos[p->nivel], esc);
+}
+
+void escalonador_bloqueia_processo(processo* p, fila_processos* espera, escalonador_t* esc)
+{
+    // Se já estava em alguma fila, sai de lá antes (não pode estar em duas).
+    if(p->fila != NULL)
+        fila_remove(p->fila, p);
+
+    fila_insere_fim(espera, p);
+}
+
+processo* escalonador_acorda_processo(fila_processos* espera, escalonador_t* esc)
+{
+    processo* p = fila_retira_inicio(espera);
+    if(p != NULL)
+        escalonador_enfila_processo(p, esc);
 
+    return p;
 }
 
 // Pop da fila.
 
 processo* escalonador_desenfila_processo(escalonador_t* esc)
 {
-    if(esc->fila_prontos->raiz == NULL)
+    for(int i = 0; i < esc->n_niveis; i++)
+    {
+        processo* p = fila_retira_inicio(&esc->filas_prontos[i]);
+        if(p != NULL)
+            return p;
+    }
+
+    return NULL;
+}
+
+void escalonador_remove_processo(processo* p, escalonador_t* esc)
+{
+    if(p->fila != NULL)
+        fila_remove(p->fila, p);
+}
+
+int escalonador_quantum(processo* p, escalonador_t* esc)
+{
+    atualiza_nivel(p, esc);
+    return esc->quanta[p->nivel];
+}
+
+void escalonador_fim_quantum(processo* p, escalonador_t* esc)
+{
+    atualiza_nivel(p, esc);
+    if(p->nivel < esc->n_niveis - 1)
+        p->nivel++;
+
+    escalonador_enfila_processo(p, esc);
+}
+
+void escalonador_promove_processo(processo* p, escalonador_t* esc)
+{
+    atualiza_nivel(p, esc);
+    if(p->nivel > 0)
+        p->nivel--;
+}
+
+void escalonador_fim_rajada(processo* p, escalonador_t* esc)
+{
+    if(p->estimativa < 0)
+        p->estimativa = esc->estimativa_inicial;
+    p->estimativa = esc->alfa * p->rajada + (1 - esc->alfa) * p->estimativa;
+    p->rajada = 0;
+}
+
+bool escalonador_tem_prioritario(processo* p, escalonador_t* esc)
+{
+    if(esc->politica == POLITICA_SRT)
     {
-        //printf("Escalonador retornou nulo, não havia um nó raiz de processo.");
-        return NULL;
+        processo* primeiro = esc->filas_prontos[0].inicio;
+        return primeiro != NULL && restante(primeiro, esc) < restante(p, esc);
     }
 
-    no_processo* no_p = esc->fila_prontos->raiz;
-    esc->fila_prontos->raiz = no_p->proximo_no;
-    processo* proc = no_p->proc;
-    libera_no(no_p);
+    atualiza_nivel(p, esc);
+    for(int i = 0; i < p->nivel; i++)
+    {
+        if(esc->filas_prontos[i].inicio != NULL)
+            return true;
+    }
 
-    return proc;
+    return false;
 }
 
-static no_processo* fila_acha_fim(fila_processos* f)
+void escalonador_tictac(escalonador_t* esc)
 {
-    no_processo* no_p = f->raiz;
+    if(esc->periodo_boost == 0 || --esc->tempo_ate_boost > 0)
+        return;
 
-    if(no_p == NULL)
+    // Boost: todo mundo volta pro primeiro nível. Os prontos passam pra fila do
+    // primeiro nível já aqui, na ordem dos níveis; os outros (executando ou
+    // bloqueados) só percebem a época nova quando passarem pelo escalonador.
+    esc->tempo_ate_boost = esc->periodo_boost;
+    esc->epoca_boost++;
+    for(int i = 1; i < esc->n_niveis; i++)
     {
-        printf("\nA fila está vazia e buscaram o fim dela. :C\n");
+        processo* p;
+        while((p = fila_retira_inicio(&esc->filas_prontos[i])) != NULL)
+            escalonador_enfila_processo(p, esc);
     }
+}
 
-    while(no_p->proximo_no != NULL)
+// Se teve boost desde a última vez que o processo passou por aqui, ele volta pro
+// primeiro nível.
+static void atualiza_nivel(processo* p, escalonador_t* esc)
+{
+    if(p->epoca_boost != esc->epoca_boost)
     {
-        no_p = no_p->proximo_no;
+        p->epoca_boost = esc->epoca_boost;
+        p->nivel = 0;
     }
+}
+
+// SRT: quanto falta da rajada do processo, pela estimativa.
+static float restante(processo* p, escalonador_t* esc)
+{
+    float estimativa = p->estimativa < 0 ? esc->estimativa_inicial : p->estimativa;
+    if(p->rajada >= estimativa)
+        return 0;
 
-    return no_p;
+    return estimativa - p->rajada;
 }
 
-static no_processo* cria_no(processo* p)
+// Insere depois do último que tem restante menor ou igual (empate fica na ordem de
+// chegada). Procura do fim pro começo.
+static void fila_insere_ordenado(fila_processos* f, processo* p, escalonador_t* esc)
 {
-    no_processo* no_p = malloc(sizeof(no_processo));
+    float r = restante(p, esc);
+    processo* anterior = f->fim;
+    while(anterior != NULL && restante(anterior, esc) > r)
+        anterior = anterior->anterior_fila;
 
-    no_p->prioridade = 1;
-    no_p->proc = p;
-    no_p->proximo_no = NULL;
+    if(anterior == NULL)
+    {
+        // Vai pro início.
+        p->anterior_fila = NULL;
+        p->proximo_fila = f->inicio;
+        if(f->inicio == NULL)
+            f->fim = p;
+        else
+            f->inicio->anterior_fila = p;
+        f->inicio = p;
+        p->fila = f;
+        f->tamanho++;
+        return;
+    }
+    if(anterior == f->fim)
+    {
+        fila_insere_fim(f, p);
+        return;
+    }
+
+    p->anterior_fila = anterior;
+    p->proximo_fila = anterior->proximo_fila;
+    anterior->proximo_fila->anterior_fila = p;
+    anterior->proximo_fila = p;
+    p->fila = f;
+    f->tamanho++;
+}
+
+void fila_inicializa(fila_processos* f)
+{
+    f->inicio = NULL;
+    f->fim = NULL;
+    f->tamanho = 0;
+}
+
+static void fila_insere_fim(fila_processos* f, processo* p)
+{
+    p->fila = f;
+    p->anterior_fila = f->fim;
+    p->proximo_fila = NULL;
+
+    if(f->fim == NULL)
+        f->inicio = p;
+    else
+        f->fim->proximo_fila = p;
+
+    f->fim = p;
+    f->tamanho++;
+}
+
+static processo* fila_retira_inicio(fila_processos* f)
+{
+    processo* p = f->inicio;
+    if(p != NULL)
+        fila_remove(f, p);
 
-    return no_p;
+    return p;
 }
 
-static void libera_no(no_processo* no_p)
+static void fila_remove(fila_processos* f, processo* p)
 {
-    free(no_p);
-}
\ No newline at end of file
+    if(p->anterior_fila == NULL)
+        f->inicio = p->proximo_fila;
+    else
+        p->anterior_fila->proximo_fila = p->proximo_fila;
+
+    if(p->proximo_fila == NULL)
+        f->fim = p->anterior_fila;
+    else
+        p->proximo_fila->anterior_fila = p->anterior_fila;
+
+    p->fila = NULL;
+    p->anterior_fila = NULL;
+    p->proximo_fila = NULL;
+    f->tamanho--;
+}
@@ -1,36 +1,65 @@
+#ifndef ESCALONADOR_H
+#define ESCALONADOR_H
 
-#include "memoria.h"
-#include "cpu.h"
-#include "console.h"
-#include "relogio.h"
+#include "processos.h"
 
-typedef struct fila_processos fila_processos;
-typedef struct no_processo no_processo;
-typedef struct escalonador_t escalonador_t;
+#include <stdbool.h>
 
-//Possívelmente adptável a receber multiplas filas diferentes, cada fila com uma prioridade
-//Seria uma alternativa a usar prioridade nos nós, faria mais sentido.
+typedef struct escalonador_t escalonador_t;
 
-//Poderia armazenar só o PID, mas to pensando que talvez seja interessante manter o estado do processo também.
-struct no_processo
+// Políticas de escalonamento.
+// Round-robin: uma fila de prontos só, todo mundo com o mesmo quantum.
+// MLFQ (multi-level feedback queue): uma fila de prontos por nível de prioridade,
+// cada nível com o seu quantum. Sempre executa um processo do nível mais alto que
+// tem alguém pronto. Quem gasta o quantum todo desce um nível (usa muita CPU), quem
+// bloqueia pra fazer E/S sobe um nível. De tempos em tempos todo mundo volta pro
+// primeiro nível (boost), pra quem desceu não ficar esquecido lá embaixo.
+// SRT (shortest remaining time): executa o processo que deve terminar a sua rajada
+// de CPU antes. A próxima rajada de cada processo é prevista pela média exponencial
+// das anteriores (estimativa = alfa * última + (1 - alfa) * estimativa), e o que
+// falta é a estimativa menos o que ele já usou da rajada atual. A fila de prontos é
+// mantida em ordem do que falta.
+typedef enum
 {
-    int pid;
-    float prioridade; //Não usado    
-    processo* proc; //Processo representado pelo nó.
+    POLITICA_RR,
+    POLITICA_MLFQ,
+    POLITICA_SRT
+} politica_escalonador;
 
-    no_processo* proximo_no;
+// Um processo bloqueado fica numa fila de espera do motivo do bloqueio, que é de
+// quem tem o recurso (o SO tem uma por terminal e direção, cada processo tem a dos
+// que esperam ele morrer). Quando o recurso fica disponível, são acordados só os
+// processos daquela fila, e eles voltam pra fila de prontos do nível deles.
+struct escalonador_t{
+    politica_escalonador politica;
+    int n_niveis;
+    int* quanta;                    // quantum de cada nível (o 0 é o mais prioritário)
+    fila_processos* filas_prontos;  // uma por nível
+    int periodo_boost;              // em interrupções de relógio, 0 se não tem boost
+    int tempo_ate_boost;
+    int epoca_boost;                // quantos boosts já teve (ver processo->epoca_boost)
+    float alfa;                     // SRT: peso da última rajada na estimativa
+    float estimativa_inicial;       // SRT: estimativa de quem ainda não teve rajada
 };
 
-struct fila_processos
-{
-    no_processo* raiz;
-};
+escalonador_t* escalonador_cria(int quantum); //Inicializa o escalonador round-robin.
+escalonador_t* escalonador_cria_mlfq(int n_niveis, const int quanta[], int periodo_boost); //Inicializa o MLFQ.
+escalonador_t* escalonador_cria_srt(int quantum, float alfa, float estimativa_inicial); //Inicializa o SRT.
+char* escalonador_nome(escalonador_t* esc);
+void escalonador_destroi(escalonador_t* esc);
+void escalonador_enfila_processo(processo* p, escalonador_t* esc);          //Insere um elemento no final da fila de prontos do nível dele.
+processo* escalonador_desenfila_processo(escalonador_t* esc);  //Remove o primeiro elemento dos prontos de maior prioridade e retorna
+void escalonador_bloqueia_processo(processo* p, fila_processos* espera, escalonador_t* esc); //Coloca o processo no final da fila de espera.
+processo* escalonador_acorda_processo(fila_processos* espera, escalonador_t* esc); //Passa o primeiro da fila de espera pros prontos e retorna (NULL se vazia).
 
-struct escalonador_t{
-    fila_processos* fila_prontos;
-    //fila_processos fila_nao_prontos;
-};
+int escalonador_quantum(processo* p, escalonador_t* esc); //Quantum que o processo recebe quando é escolhido.
+void escalonador_fim_quantum(processo* p, escalonador_t* esc); //O processo gastou o quantum: desce um nível e vai pros prontos.
+void escalonador_promove_processo(processo* p, escalonador_t* esc); //O processo bloqueou pra E/S: sobe um nível.
+void escalonador_fim_rajada(processo* p, escalonador_t* esc); //A rajada de p terminou (bloqueou ou gastou o quantum): atualiza a estimativa.
+bool escalonador_tem_prioritario(processo* p, escalonador_t* esc); //Tem processo pronto que deveria executar antes de p (em execução)?
+void escalonador_tictac(escalonador_t* esc); //Passou uma interrupção de relógio (conta o tempo até o boost).
+
+void fila_inicializa(fila_processos* f); //Deixa uma fila (de espera) vazia.
+void escalonador_remove_processo(processo* p, escalonador_t* esc); //Tira o processo da fila em que ele estiver (se estiver em alguma).
 
-escalonador_t* escalonador_cria(); //Inicializa o escalonador.
-void escalonador_enfila_processo(processo* p, escalonador_t* esc);          //Insere um elemento no final da fila.
-processo* escalonador_desenfila_processo(escalonador_t* esc);  //Remove o primeiro elemento e retorna
+#endif
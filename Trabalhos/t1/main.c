@@ -77,6 +77,8 @@ int main()
   // executa o laço de execução da CPU
   controle_laco(hw.controle);
 
+  so_imprime_estatisticas(so);
+
   // destroi tudo
   so_destroi(so);
   destroi_hardware(&hw);
@@ -17,8 +17,22 @@ processo* cria_processo(int PC, int A, int X, err_t erro, int complemento, cpu_m
     process->estado_processo = estado_processo;
     process->pid = pid;
     process->quantum = 0;
+    process->nivel = 0;
+    process->epoca_boost = 0;
+    process->t_criacao = 0;
+    process->t_primeira_execucao = -1;
+    process->inicio_execucao = 0;
+    process->rajada = 0;
+    process->estimativa = -1;
     process->terminal = terminal;
 
+    process->fila = NULL;
+    process->anterior_fila = NULL;
+    process->proximo_fila = NULL;
+    process->esperando_fim.inicio = NULL;
+    process->esperando_fim.fim = NULL;
+    process->esperando_fim.tamanho = 0;
+
     return process;
 }
 
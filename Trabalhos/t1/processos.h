@@ -15,6 +15,7 @@ typedef enum
 
 typedef struct processo processo;
 typedef struct cpu_state cpu_state;
+typedef struct fila_processos fila_processos;
 
 struct cpu_state
 {
@@ -26,6 +27,17 @@ struct cpu_state
     cpu_modo_t modo;
 };
 
+// Fila de processos intrusiva: os nós são os próprios processos, ligados pelos
+// campos anterior_fila e proximo_fila. Com ponteiro pro início e pro fim, inserir no
+// final, tirar do início e remover um processo qualquer são O(1), sem malloc/free.
+// Um processo só pode estar em uma fila por vez (a de prontos ou uma de espera).
+struct fila_processos
+{
+    processo* inicio;
+    processo* fim;
+    int tamanho;
+};
+
 struct processo
 {
     cpu_state* estado_cpu;
@@ -33,6 +45,24 @@ struct processo
     int pid;
     int terminal;
     int quantum;
+    int nivel;       // nível de prioridade no MLFQ (0 é o mais alto)
+    int epoca_boost; // se for diferente da do escalonador, teve boost e o nível volta pra 0
+
+    // Tempos, em instruções executadas (o relógio do simulador).
+    int t_criacao;
+    int t_primeira_execucao; // -1 se ainda não foi escolhido pra executar
+    int inicio_execucao;     // quando foi pra CPU (ou quando a rajada foi contabilizada) pela última vez
+    int rajada;              // CPU usada na rajada atual (até bloquear ou gastar o quantum)
+    float estimativa;        // previsão da próxima rajada (SRT), -1 se ainda não tem
+
+    // Ligações da fila em que o processo está (ver escalonador.h).
+    // Ficam no próprio processo, assim entrar e sair da fila não precisa alocar nada.
+    fila_processos* fila; // NULL se não está em nenhuma fila
+    processo* anterior_fila;
+    processo* proximo_fila;
+
+    // Processos esperando este morrer (SO_ESPERA_PROC), acordados quando ele morre.
+    fila_processos esperando_fim;
 };
 
 processo* cria_processo(int PC, int A, int X, err_t erro, int complemento, cpu_modo_t modo, pr_state estado_processo, int pid, int terminal);
@@ -12,6 +12,19 @@
 // intervalo entre interrupções do relógio
 #define INTERVALO_INTERRUPCAO 20   // em instruções executadas
 #define DEFAULT_QUANTUM_SIZE 5    //Define quanto cada processo recebe de quantums (interrupções de relogio)
+// MLFQ (compilado com -DESCALONADOR_MLFQ, ver Makefile): quantum de cada nível, do
+// mais prioritário pro menos (o número de níveis é o tamanho do vetor), e de quantas
+// em quantas interrupções de relógio todos voltam pro primeiro nível
+#ifndef MLFQ_QUANTA
+#define MLFQ_QUANTA { 2, 4, 8 }
+#endif
+#ifndef MLFQ_PERIODO_BOOST
+#define MLFQ_PERIODO_BOOST 100
+#endif
+// SRT (compilado com -DESCALONADOR_SRT): peso da última rajada na estimativa da
+// próxima, e estimativa de quem ainda não teve nenhuma rajada (em instruções)
+#define SRT_ALFA 0.5
+#define SRT_ESTIMATIVA_INICIAL (DEFAULT_QUANTUM_SIZE * INTERVALO_INTERRUPCAO)
 #define TAMANHO_TABELA 10
 #define TOTAL_TERMINAIS 4
 
@@ -27,6 +40,15 @@ struct so_t {
   processo* tab_processos[TAMANHO_TABELA];
 
   int uso_terminais[TOTAL_TERMINAIS];
+
+  // Contabilidade dos processos que já terminaram, pra comparar escalonadores
+  // (tempos em instruções executadas).
+  int n_terminados;
+  long soma_retorno;   // da criação até morrer (turnaround)
+  long soma_resposta;  // da criação até executar pela primeira vez
+  // Processos bloqueados esperando cada terminal poder ler ou escrever.
+  fila_processos espera_leitura[TOTAL_TERMINAIS];
+  fila_processos espera_escrita[TOTAL_TERMINAIS];
 };
 
 
@@ -40,7 +62,11 @@ static bool copia_str_da_mem(int tam, char str[tam], mem_t *mem, int ender);
 // funções auxiliares gerais
 static void reseta_processos(so_t *self);
 static void libera_espera(so_t *self, processo* process);
-static void libera_bloqueio(so_t *self, processo* process);
+static void libera_bloqueio_leitura(so_t *self, int terminal);
+static void libera_bloqueio_escrita(so_t *self, int terminal);
+static void encerra_processo(so_t *self, int indice);
+static void contabiliza_execucao(so_t *self, processo* process);
+static void fim_rajada(so_t *self, processo* process);
 static processo* busca_processo(so_t *self, int pid);
 static int busca_indice_processo(so_t *self, int pid);
 static int encontra_terminal_livre(so_t *self);
@@ -56,7 +82,14 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, console_t *console, relogio_t *relogio)
   self->console = console;
   self->relogio = relogio;
 
-  self->escalonador = escalonador_cria();
+#if defined(ESCALONADOR_MLFQ)
+  int quanta[] = MLFQ_QUANTA;
+  self->escalonador = escalonador_cria_mlfq(sizeof(quanta) / sizeof(quanta[0]), quanta, MLFQ_PERIODO_BOOST);
+#elif defined(ESCALONADOR_SRT)
+  self->escalonador = escalonador_cria_srt(DEFAULT_QUANTUM_SIZE, SRT_ALFA, SRT_ESTIMATIVA_INICIAL);
+#else
+  self->escalonador = escalonador_cria(DEFAULT_QUANTUM_SIZE);
+#endif
 
   reseta_processos(self);
 
@@ -81,9 +114,20 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, console_t *console, relogio_t *relogio)
   return self;
 }
 
+void so_imprime_estatisticas(so_t *self)
+{
+  if (self->n_terminados == 0) return;
+  console_printf(self->console,
+      "SO: escalonador %s, %d processos terminados, tempo medio de retorno %ld,"
+      " de resposta %ld (em instrucoes)", escalonador_nome(self->escalonador),
+      self->n_terminados, self->soma_retorno / self->n_terminados,
+      self->soma_resposta / self->n_terminados);
+}
+
 void so_destroi(so_t *self)
 {
   cpu_define_chamaC(self->cpu, NULL, NULL);
+  escalonador_destroi(self->escalonador);
   free(self);
 }
 
@@ -168,11 +212,13 @@ static void so_trata_pendencias(so_t *self)
   // - desbloqueio de processos
   // - contabilidades
 
-  for (int i = 0; i < TAMANHO_TABELA; i++)
+  // Os terminais nao geram interrupcao, entao o estado deles eh consultado aqui,
+  // mas so pra filas de espera que nao estao vazias. Quem espera outro processo
+  // eh acordado quando ele morre (encerra_processo).
+  for (int i = 0; i < TOTAL_TERMINAIS; i++)
   {
-    if (self->tab_processos[i] == NULL) continue;
-    if (self->tab_processos[i]->estado_processo == WAITING) libera_espera(self, self->tab_processos[i]);
-    if (self->tab_processos[i]->estado_processo == BLOCKED) libera_bloqueio(self, self->tab_processos[i]);
+    libera_bloqueio_leitura(self, i);
+    libera_bloqueio_escrita(self, i);
   }
 }
 static void so_escalona(so_t *self)
@@ -180,35 +226,40 @@ static void so_escalona(so_t *self)
   
   if(self->processo_atual >= 0)
   {
-    if((self->tab_processos[self->processo_atual])->quantum > 0)
-      return;
-
-    escalonador_enfila_processo(self->tab_processos[self->processo_atual], self->escalonador);
+    processo* atual = self->tab_processos[self->processo_atual];
+    contabiliza_execucao(self, atual);
+    // Continua executando enquanto tiver quantum, a nao ser que tenha ficado pronto
+    // um processo mais prioritario (no MLFQ, ou com rajada mais curta no SRT); nesse
+    // caso perde a vez sem descer de nivel.
+    if(atual->quantum > 0)
+    {
+      if(!escalonador_tem_prioritario(atual, self->escalonador))
+        return;
+      atual->estado_processo = READY;
+      escalonador_enfila_processo(atual, self->escalonador);
+    }
+    else
+    {
+      atual->estado_processo = READY;
+      escalonador_fim_quantum(atual, self->escalonador);
+    }
   }
 
-
-  //Pede pro escalonador até achar um processo ready.
-  //O escalonador assume que os processos na lista dele estao ready, mas na verdade ele guarda todos os processos.
-  
-  //console_printf(self->console, "Escalonador em ação");
-  processo* processo_candidato = NULL; 
-  processo_candidato = escalonador_desenfila_processo(self->escalonador);
-  while(NULL != processo_candidato)
+  // Na fila de prontos so tem processo pronto pra executar. Os bloqueados estao
+  // nas filas deles, e so voltam pra ca quando sao liberados.
+  processo* processo_escolhido = escalonador_desenfila_processo(self->escalonador);
+  if(processo_escolhido == NULL)
   {
-      if (processo_candidato->estado_processo != READY)
-      {        
-        //console_printf(self->console, "Escalonador me retornou nulo, mas que filho da puta.");
-        escalonador_enfila_processo(processo_candidato, self->escalonador);
-        processo_candidato = escalonador_desenfila_processo(self->escalonador);
-        continue;
-      }
-
-      self->processo_atual = busca_indice_processo(self, processo_candidato->pid);
-      self->tab_processos[self->processo_atual]->quantum = DEFAULT_QUANTUM_SIZE;    
-
-      return;
+    self->processo_atual = -1;
+    return;
   }
-  self->processo_atual = -1;
+
+  self->processo_atual = busca_indice_processo(self, processo_escolhido->pid);
+  processo_escolhido->estado_processo = RUNNING;
+  processo_escolhido->quantum = escalonador_quantum(processo_escolhido, self->escalonador);
+  processo_escolhido->inicio_execucao = rel_agora(self->relogio);
+  if(processo_escolhido->t_primeira_execucao == -1)
+    processo_escolhido->t_primeira_execucao = processo_escolhido->inicio_execucao;
 }
 static void so_despacha(so_t *self)
 {
@@ -266,6 +317,13 @@ static err_t so_trata_irq_reset(so_t *self)
 
   self->tab_processos[self->processo_atual] = cria_processo(ender, 0, 0, ERR_OK, 0, usuario, READY, self->pid_atual, terminal);
   processo* process = self->tab_processos[self->processo_atual];
+  process->t_criacao = rel_agora(self->relogio);
+  // O init ja comeca executando, com o quantum do nivel dele; sem isso o primeiro
+  // so_escalona acharia que ele gastou o quantum (e no MLFQ ele desceria de nivel).
+  process->estado_processo = RUNNING;
+  process->quantum = escalonador_quantum(process, self->escalonador);
+  process->inicio_execucao = process->t_criacao;
+  process->t_primeira_execucao = process->t_criacao;
   (self->uso_terminais[terminal])++;
 
   mem_escreve(self->mem, IRQ_END_PC, process->estado_cpu->PC);
@@ -296,9 +354,7 @@ static err_t so_trata_irq_err_cpu(so_t *self)
   console_printf(self->console,
       "SO: Erro na CPU: %s", err_nome(err));
 
-  (self->uso_terminais[process->terminal])--;
-  mata_processo(process);
-  self->tab_processos[self->processo_atual] = NULL;
+  encerra_processo(self, self->processo_atual);
   self->processo_atual = -1;
 
   return ERR_OK;
@@ -315,8 +371,13 @@ static err_t so_trata_irq_relogio(so_t *self)
   if(self->processo_atual > -1)
   {    
     console_printf(self->console, "SO: interrupção do relógio, decrementando o quantum.");
-    self->tab_processos[self->processo_atual]->quantum--;
+    processo* process = self->tab_processos[self->processo_atual];
+    process->quantum--;
+    // Gastou o quantum: acabou a rajada (o processo sai da CPU no so_escalona).
+    if(process->quantum <= 0)
+      fim_rajada(self, process);
   }
+  escalonador_tictac(self->escalonador);
   return ERR_OK;
 }
 
@@ -375,6 +436,9 @@ static void so_chamada_le(so_t *self)
   if (estado == 0)
   {
     process->estado_processo = BLOCKED;
+    fim_rajada(self, process);
+    escalonador_promove_processo(process, self->escalonador);
+    escalonador_bloqueia_processo(process, &self->espera_leitura[process->terminal], self->escalonador);
     process->estado_cpu->A = -1;
     self->processo_atual = -1;
     return;
@@ -395,6 +459,9 @@ static void so_chamada_escr(so_t *self)
   {    
     console_printf(self->console, "Processo %d bloqueado para escrita", process->pid);    
     process->estado_processo = BLOCKED;    
+    fim_rajada(self, process);
+    escalonador_promove_processo(process, self->escalonador);
+    escalonador_bloqueia_processo(process, &self->espera_escrita[process->terminal], self->escalonador);
     process->estado_cpu->A = -1;    
     self->processo_atual = -1;    
     return;
@@ -424,6 +491,7 @@ static void so_chamada_cria_proc(so_t *self)
       (self->uso_terminais[terminal])++;
 
       self->tab_processos[posicao_processo] = cria_processo(ender_carga, 0, 0, ERR_OK, 0, usuario, READY, self->pid_atual, terminal);
+      self->tab_processos[posicao_processo]->t_criacao = rel_agora(self->relogio);
       escalonador_enfila_processo(self->tab_processos[posicao_processo], self->escalonador);
       process->estado_cpu->A = self->pid_atual;
 
@@ -438,23 +506,26 @@ static void so_chamada_mata_proc(so_t *self)
 {
   processo* process = self->tab_processos[self->processo_atual];
 
-  if (process->estado_cpu->X == 0)
+  int i = self->processo_atual;
+  if (process->estado_cpu->X != 0)
+    i = busca_indice_processo(self, process->estado_cpu->X);
+
+  if (i == -1)
   {
-    (self->uso_terminais[process->terminal])--;
+    process->estado_cpu->A = -1;
+    return;
+  }
 
-    mata_processo(self->tab_processos[self->processo_atual]);
-    self->tab_processos[self->processo_atual] = NULL;
+  // Matar o proprio processo (X == 0 ou o pid dele) libera o descritor, entao nao
+  // tem mais onde colocar o retorno.
+  if (i == self->processo_atual)
+  {
+    encerra_processo(self, i);
     self->processo_atual = -1;
     return;
   }
 
-  int i = 0;
-  while (i < TAMANHO_TABELA && (self->tab_processos[i])->pid != process->estado_cpu->X) i++;
-  if (i == TAMANHO_TABELA) return;
-
-  (self->uso_terminais[(self->tab_processos[i])->terminal])--;
-  mata_processo(self->tab_processos[i]);
-  self->tab_processos[i] = NULL;
+  encerra_processo(self, i);
 
   process->estado_cpu->A = 0;
 }
@@ -473,6 +544,8 @@ static void so_chamada_espera_proc(so_t *self)
   self->processo_atual = -1;
   process->estado_cpu->A = 0;
   process->estado_processo = WAITING;
+  fim_rajada(self, process);
+  escalonador_bloqueia_processo(process, &processo_espera->esperando_fim, self->escalonador);
 }
 
 
@@ -537,60 +610,106 @@ static void reseta_processos(so_t *self)
   {
     self->tab_processos[i] = NULL;
   }
+  self->n_terminados = 0;
+  self->soma_retorno = 0;
+  self->soma_resposta = 0;
   for(int i = 0; i < TOTAL_TERMINAIS; i++)
   {
     self->uso_terminais[i] = 0;
+    fila_inicializa(&self->espera_leitura[i]);
+    fila_inicializa(&self->espera_escrita[i]);
   }
 }
 
+// Acorda os processos que estavam esperando o processo que vai morrer.
 static void libera_espera(so_t *self, processo* process)
 {
-  for (int i = 0; i < TAMANHO_TABELA; i++)
+  processo* esperando;
+  while ((esperando = escalonador_acorda_processo(&process->esperando_fim, self->escalonador)) != NULL)
   {
-    if (self->tab_processos[i] == NULL) continue;
-    if ((self->tab_processos[i])->pid == process->estado_cpu->X) return;
+    esperando->estado_processo = READY;
   }
-  process->estado_processo = READY;
-  escalonador_enfila_processo(process, self->escalonador);
 }
 
-// PROVAVELMENTE PRECISA SER REFATORADA!
-// Somente processos bloqueados entraram nessa funcao.
-// A gente tem q encontrar alguma forma de identificar o motivo
-// do bloqueio de um processo, pra gente conseguir verificar se a causa
-// desse bloqueio ja foi resolvida, e entao desbloquear ele.
-//
-// Uma ideia que eu tive é o SO armazenar os processos bloqueados
-// junto com um identificador. Seria um vetor de pares (processo, bloqueio).
-// Dessa forma, da pra identificar o que bloqueou o processo e tratar isso na hora
-// de liberar ele. 
-//
-// Outra opcao eh adicionar mais um campo no processo, identificando porque ele foi bloqueado.
-static void libera_bloqueio(so_t *self, processo* process)
+// Os processos bloqueados no terminal ficam na fila de espera da direcao
+// (leitura ou escrita) daquele terminal. O estado do terminal eh consultado uma
+// vez por fila que tem alguem esperando, e enquanto o terminal estiver pronto os
+// processos sao liberados em ordem: a operacao que tinha bloqueado eh feita aqui,
+// e o processo volta pra fila de prontos.
+static void libera_bloqueio_leitura(so_t *self, int terminal)
 {
-  console_printf(self->console, "SO: Tentando liberar processo %d", process->pid);
+  fila_processos* espera = &self->espera_leitura[terminal];
+  int inicio_terminal = terminal * 4;
 
-  int inicio_terminal = process->terminal * 4;
+  while (espera->inicio != NULL)
+  {
+    int estadoLeitura;
+    term_le(self->console, inicio_terminal + 1, &estadoLeitura);
+    if (estadoLeitura == 0) return;
 
-  int estadoLeitura, estadoEscrita;
-  term_le(self->console, inicio_terminal + 1, &estadoLeitura);
-  term_le(self->console, inicio_terminal + 3, &estadoEscrita);
+    processo* process = espera->inicio;
+    term_le(self->console, inicio_terminal, &(process->estado_cpu->A));
+    process->estado_processo = READY;
+    escalonador_acorda_processo(espera, self->escalonador);
+    console_printf(self->console, "SO: Processo %d liberado para leitura", process->pid);
+  }
+}
 
-  // So esta sendo considerado o desbloqueio de processos que foram
-  // bloqueados por nao conseguir escrever.
-  // Se esse processo poder ser desbloqueado, entao eh necessario fazer a
-  // escrita do caracter que tinha sido bloqueado, por isso term_escr eh chamado
-  // dentro desse if.
-  if (estadoEscrita != 0)
+static void libera_bloqueio_escrita(so_t *self, int terminal)
+{
+  fila_processos* espera = &self->espera_escrita[terminal];
+  int inicio_terminal = terminal * 4;
+
+  while (espera->inicio != NULL)
   {
+    int estadoEscrita;
+    term_le(self->console, inicio_terminal + 3, &estadoEscrita);
+    if (estadoEscrita == 0) return;
+
+    processo* process = espera->inicio;
     term_escr(self->console, inicio_terminal + 2, process->estado_cpu->X);
     process->estado_processo = READY;
     process->estado_cpu->A = 0;
-    escalonador_enfila_processo(process, self->escalonador);
+    escalonador_acorda_processo(espera, self->escalonador);
     console_printf(self->console, "SO: Processo %d liberado para escrita", process->pid);
   }
 }
 
+// Tira o processo da tabela e de qualquer fila, acorda quem esperava por ele e
+// libera o descritor.
+static void encerra_processo(so_t *self, int indice)
+{
+  processo* process = self->tab_processos[indice];
+
+  int agora = rel_agora(self->relogio);
+  self->n_terminados++;
+  self->soma_retorno += agora - process->t_criacao;
+  if(process->t_primeira_execucao != -1)
+    self->soma_resposta += process->t_primeira_execucao - process->t_criacao;
+
+  (self->uso_terminais[process->terminal])--;
+  escalonador_remove_processo(process, self->escalonador);
+  libera_espera(self, process);
+  mata_processo(process);
+  self->tab_processos[indice] = NULL;
+}
+
+// Soma na rajada do processo a CPU que ele usou desde que foi pra CPU (ou desde a
+// ultima vez que isso foi contabilizado).
+static void contabiliza_execucao(so_t *self, processo* process)
+{
+  int agora = rel_agora(self->relogio);
+  process->rajada += agora - process->inicio_execucao;
+  process->inicio_execucao = agora;
+}
+
+// O processo vai sair da CPU porque bloqueou ou gastou o quantum: a rajada dele
+// terminou, e entra na estimativa da proxima.
+static void fim_rajada(so_t *self, processo* process)
+{
+  contabiliza_execucao(self, process);
+  escalonador_fim_rajada(process, self->escalonador);
+}
 
 static processo* busca_processo(so_t *self, int pid)
 {
@@ -15,6 +15,10 @@ typedef struct so_t so_t;
 so_t *so_cria(cpu_t *cpu, mem_t *mem, console_t *console, relogio_t *relogio);
 void so_destroi(so_t *self);
 
+// mostra na console os tempos médios de retorno (da criação até o fim) e de
+//   resposta (da criação até a primeira execução) dos processos que terminaram
+void so_imprime_estatisticas(so_t *self);
+
 // Chamadas de sistema
 // Uma chamada de sistema é realizada colocando a identificação da
 //   chamada (um dos valores abaixo) no registrador A e executando a
@@ -4,19 +4,26 @@
 #include <string.h>
 #include <stdio.h>
 
+// número máximo de instruções executadas a cada volta do laço principal,
+//   entre duas verificações do teclado e atualizações da tela
+#define INSTRUCOES_POR_LACO 1000
+
 struct controle_t {
   cpu_t *cpu;
   relogio_t *relogio;
   console_t *console;
+  disco_t *disco;
   enum { executando, passo, parado, fim } estado;
 };
 
 // funções auxiliares
+static void controle_executa(controle_t *self);
 static void controle_processa_teclado(controle_t *self);
 static void controle_atualiza_console(controle_t *self);
 
 
-controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio)
+controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio,
+                          disco_t *disco)
 {
   controle_t *self = malloc(sizeof(*self));
   if (self == NULL) return NULL;
@@ -24,6 +31,7 @@ controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio)
   self->cpu = cpu;
   self->console = console;
   self->relogio = relogio;
+  self->disco = disco;
   self->estado = parado;
 
   return self;
@@ -36,19 +44,10 @@ void controle_destroi(controle_t *self)
 
 void controle_laco(controle_t *self)
 {
-  // executa uma instrução por vez até a console dizer que chega
+  // executa instruções até a console dizer que chega
   do {
     if (self->estado == passo || self->estado == executando) {
-      cpu_executa_1(self->cpu);
-      rel_tictac(self->relogio);
-      console_tictac(self->console);
-      // enquanto não tem controlador de interrupção, fala direto com o relógio
-      // o dispositivo 3 do relógio contém 1 se o timer expirou
-      int tem_int;
-      rel_le(self->relogio, 3, &tem_int);
-      if (tem_int != 0) {
-        cpu_interrompe(self->cpu, IRQ_RELOGIO);
-      }
+      controle_executa(self);
     }
     controle_processa_teclado(self);
     controle_atualiza_console(self);
@@ -59,6 +58,50 @@ void controle_laco(controle_t *self)
 }
  
 
+// executa uma instrução (no modo passo) ou uma sequência delas (no modo
+//   executando), e faz o tempo passar de acordo
+static void controle_executa(controle_t *self)
+{
+  int n = 1;
+  if (self->estado == executando) {
+    // não executa além do momento em que o relógio ou o disco vai pedir
+    //   interrupção
+    // o dispositivo 2 do relógio e o 4 do disco contêm o tempo que falta
+    //   para isso (0 se não tiver interrupção programada)
+    n = INSTRUCOES_POR_LACO;
+    int t_ate_int;
+    rel_le(self->relogio, 2, &t_ate_int);
+    if (t_ate_int > 0 && t_ate_int < n) {
+      n = t_ate_int;
+    }
+    disco_le(self->disco, 4, &t_ate_int);
+    if (t_ate_int > 0 && t_ate_int < n) {
+      n = t_ate_int;
+    }
+  }
+  int executadas = cpu_executa_n(self->cpu, n);
+  // se a CPU está parada, o tempo passa do mesmo jeito
+  if (executadas == 0) executadas = n;
+  rel_avanca(self->relogio, executadas);
+  disco_avanca(self->disco, executadas);
+  console_tictac(self->console);
+  // enquanto não tem controlador de interrupção, fala direto com o relógio
+  //   e o disco
+  // o dispositivo 3 do relógio contém 1 se o timer expirou, o 5 do disco
+  //   contém 1 se terminou uma transferência
+  // se a CPU não aceitar a interrupção (já está atendendo outra), o pedido
+  //   continua e é feito de novo na próxima vez
+  int tem_int;
+  rel_le(self->relogio, 3, &tem_int);
+  if (tem_int != 0) {
+    cpu_interrompe(self->cpu, IRQ_RELOGIO);
+  }
+  disco_le(self->disco, 5, &tem_int);
+  if (tem_int != 0) {
+    cpu_interrompe(self->cpu, IRQ_DISCO);
+  }
+}
+
 static void controle_processa_teclado(controle_t *self)
 {
   if (self->estado == passo) self->estado = parado;
@@ -13,8 +13,10 @@ typedef struct controle_t controle_t;
 #include "cpu.h"
 #include "console.h"
 #include "relogio.h"
+#include "disco.h"
 
-controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio);
+controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio,
+                          disco_t *disco);
 void controle_destroi(controle_t *self);
 
 // o laço principal da simulação
@@ -6,6 +6,39 @@
 #include <stdio.h>
 #include <string.h>
 
+// número de entradas na cache de instruções decodificadas
+#define N_DECOD 1024
+
+// uma instrução decodificada, guardada na cache de instruções
+// a cache é indexada pelo endereço físico do opcode, e contém o opcode,
+//   a forma de executar a instrução e o argumento (se já foi lido)
+// uma entrada deixa de valer quando a memória no endereço do opcode ou do
+//   argumento é alterada (ver cpu_observa_mem)
+// com CPU_THREADED, em vez da função que executa a instrução, a entrada
+//   tem o endereço do trecho de código que a executa (ver executa)
+// se a instrução inicia uma sequência comum de instruções, a entrada tem
+//   também uma superinstrução, que executa a sequência toda (ver funde)
+typedef struct decod_t decod_t;
+struct decod_t {
+  int endfis;                // endereço físico do opcode, -1 se vazia
+  int opcode;
+#ifdef CPU_THREADED
+  const void *rotulo;        // NULL até a primeira execução
+#else
+  void (*op)(cpu_t *self);   // função que executa a instrução
+#endif
+  bool tem_A1;               // true se A1 contém o argumento
+  int A1;
+  // superinstrução, NULL se não tem; retorna quantas instruções executou
+  int (*super)(cpu_t *self, decod_t *instr);
+  int n_instr;               // número de instruções na sequência
+  int n_palavras;            // número de posições de memória que ocupa
+  int args[2];               // argumentos das instruções após a primeira
+};
+
+// maior número de posições de memória ocupadas por uma superinstrução
+#define MAX_PALAVRAS_SUPER 5
+
 // uma CPU tem estado, memória, controlador de ES
 struct cpu_t {
   // registradores
@@ -18,18 +51,25 @@ struct cpu_t {
   cpu_modo_t modo;
   // acesso a dispositivos externos
   mmu_t *mmu;
+  int tam_pagina;
   es_t *es;
   // função e argumento para implementar instrução CHAMAC
   func_chamaC_t funcaoC;
   void *argC;
+  // cache de instruções decodificadas, e a instrução em execução
+  decod_t decod[N_DECOD];
+  decod_t *instr;
 };
 
+static void cpu_observa_mem(void *arg, int endereco);
+
 cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
 {
   cpu_t *self;
   self = malloc(sizeof(*self));
   if (self != NULL) {
     self->mmu = mmu;
+    self->tam_pagina = mmu_tam_pagina(mmu);
     self->es = es;
     // inicializa registradores
     self->PC = 0;
@@ -39,6 +79,13 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
     self->complemento = 0;
     self->modo = supervisor;
     self->funcaoC = NULL;
+    // esvazia a cache de instruções, e pede para ser avisada quando
+    //   a memória mudar
+    for (int i = 0; i < N_DECOD; i++) {
+      self->decod[i].endfis = -1;
+    }
+    self->instr = NULL;
+    mmu_define_observador(self->mmu, cpu_observa_mem, self);
     // gera uma interrupção de reset
     cpu_interrompe(self, IRQ_RESET);
   }
@@ -48,6 +95,7 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
 void cpu_destroi(cpu_t *self)
 {
   // eu nao criei MMU nem es; quem criou que destrua!
+  mmu_define_observador(self->mmu, NULL, NULL);
   free(self);
 }
 
@@ -98,10 +146,33 @@ static bool pega_opcode(cpu_t *self, int *popc)
   return pega_mem(self, self->PC, popc);
 }
 
+// retorna true se as 'n' posições de memória a partir do PC estão na mesma
+//   página
+// só o que está na mesma página que o opcode pode ser guardado na cache de
+//   instruções: o que está em outra página pode mudar de endereço físico
+//   quando essa outra página for mapeada em outro quadro
+static bool na_mesma_pagina(cpu_t *self, int n)
+{
+  return self->PC >= 0
+         && self->PC % self->tam_pagina + n <= self->tam_pagina;
+}
+
 // lê o argumento 1 da instrução no PC
+// usa o valor da cache de instruções se tiver; senão, lê da memória e
+//   guarda na cache, se o argumento estiver na mesma página que o opcode
 static bool pega_A1(cpu_t *self, int *pA1)
 {
-  return pega_mem(self, self->PC + 1, pA1);
+  decod_t *instr = self->instr;
+  if (instr != NULL && instr->tem_A1) {
+    *pA1 = instr->A1;
+    return true;
+  }
+  if (!pega_mem(self, self->PC + 1, pA1)) return false;
+  if (instr != NULL && na_mesma_pagina(self, 2)) {
+    instr->A1 = *pA1;
+    instr->tem_A1 = true;
+  }
+  return true;
 }
 
 // escreve um valor na memória
@@ -134,7 +205,7 @@ static bool poe_es(cpu_t *self, int dispositivo, int val)
 // ---------------------------------------------------------------------
 // funções auxiliares para implementação de cada instrução
 
-static void op_NOP(cpu_t *self) // não faz nada
+static inline void op_NOP(cpu_t *self) // não faz nada
 {
   self->PC += 1;
 }
@@ -193,7 +264,7 @@ static void op_ARMX(cpu_t *self) // armazena indexado
   }
 }
 
-static void op_TRAX(cpu_t *self) // troca A com X
+static inline void op_TRAX(cpu_t *self) // troca A com X
 {
   int A = self->A;
   int X = self->X;
@@ -202,13 +273,13 @@ static void op_TRAX(cpu_t *self) // troca A com X
   self->PC += 1;
 }
 
-static void op_CPXA(cpu_t *self) // copia X para A
+static inline void op_CPXA(cpu_t *self) // copia X para A
 {
   self->A = self->X;
   self->PC += 1;
 }
 
-static void op_INCX(cpu_t *self) // incrementa X
+static inline void op_INCX(cpu_t *self) // incrementa X
 {
   self->X += 1;
   self->PC += 1;
@@ -259,7 +330,7 @@ static void op_RESTO(cpu_t *self) // resto
   }
 }
 
-static void op_NEG(cpu_t *self) // inverte sinal
+static inline void op_NEG(cpu_t *self) // inverte sinal
 {
   self->A = -self->A;
   self->PC += 1;
@@ -384,64 +455,405 @@ static void op_CHAMAS(cpu_t *self) // chamada de sistema
 
 }
 
-void cpu_executa_1(cpu_t *self)
+static void op_INV(cpu_t *self) // opcode inválido
 {
-  // não executa se CPU já estiver em erro
-  if (self->erro != ERR_OK) return;
+  self->erro = ERR_INSTR_INV;
+}
 
-  int opcode;
-  if (!pega_opcode(self, &opcode)) return;
+// ---------------------------------------------------------------------
+// superinstruções
+// cada uma executa uma sequência de instruções que aparece com frequência
+//   nos programas, com o mesmo efeito que a execução das instruções uma a
+//   uma; se uma instrução da sequência der erro, as anteriores ficam
+//   executadas e o estado da CPU é o mesmo que seria sem a superinstrução
+// os argumentos das instruções estão em instr->A1 (o da primeira) e
+//   instr->args (os das seguintes)
+// retornam o número de instruções executadas (incluindo a que deu erro)
+
+static int super_INCX_CPXA(cpu_t *self, decod_t *instr)
+{
+  self->X += 1;
+  self->A = self->X;
+  self->PC += 2;
+  return 2;
+}
+
+static int super_CARGX_DESVZ(cpu_t *self, decod_t *instr)
+{
+  int mA1mX;
+  if (!pega_mem(self, instr->A1 + self->X, &mA1mX)) return 1;
+  self->A = mA1mX;
+  if (self->A == 0) {
+    self->PC = instr->args[0];
+  } else {
+    self->PC += 4;
+  }
+  return 2;
+}
+
+static int super_CPXA_RESTO_DESVNZ(cpu_t *self, decod_t *instr)
+{
+  int mA1;
+  self->A = self->X;
+  self->PC += 1;
+  if (!pega_mem(self, instr->args[0], &mA1)) return 2;
+  self->A %= mA1;
+  if (self->A != 0) {
+    self->PC = instr->args[1];
+  } else {
+    self->PC += 4;
+  }
+  return 3;
+}
 
+static int super_CPXA_SUB_DESVNZ(cpu_t *self, decod_t *instr)
+{
+  int mA1;
+  self->A = self->X;
+  self->PC += 1;
+  if (!pega_mem(self, instr->args[0], &mA1)) return 2;
+  self->A -= mA1;
+  if (self->A != 0) {
+    self->PC = instr->args[1];
+  } else {
+    self->PC += 4;
+  }
+  return 3;
+}
+
+// lê as 'n' posições de memória a partir do PC (a instrução e as seguintes),
+//   se estiverem todas na mesma página
+// não altera o estado da CPU em caso de erro, só retorna false
+static bool pega_seguintes(cpu_t *self, int n, int val[n])
+{
+  if (!na_mesma_pagina(self, n)) return false;
+  for (int i = 0; i < n; i++) {
+    if (mmu_le(self->mmu, self->PC + i, &val[i], self->modo) != ERR_OK) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// verifica se a instrução recém decodificada no PC inicia uma das sequências
+//   que têm superinstrução, e se for o caso coloca a superinstrução e os
+//   argumentos de toda a sequência na entrada da cache
+// a sequência toda tem que estar na mesma página
+static void funde(cpu_t *self, decod_t *instr)
+{
+  int p[MAX_PALAVRAS_SUPER];
+  instr->super = NULL;
+  switch (instr->opcode) {
+    case INCX:   // incx; cpxa
+      if (pega_seguintes(self, 2, p) && p[1] == CPXA) {
+        instr->super = super_INCX_CPXA;
+        instr->n_instr = 2;
+        instr->n_palavras = 2;
+      }
+      break;
+    case CARGX:  // cargx a; desvz b
+      if (pega_seguintes(self, 4, p) && p[2] == DESVZ) {
+        instr->super = super_CARGX_DESVZ;
+        instr->n_instr = 2;
+        instr->n_palavras = 4;
+        instr->A1 = p[1];
+        instr->tem_A1 = true;
+        instr->args[0] = p[3];
+      }
+      break;
+    case CPXA:   // cpxa; resto a; desvnz b  ou  cpxa; sub a; desvnz b
+      if (pega_seguintes(self, 5, p) && p[3] == DESVNZ) {
+        if (p[1] == RESTO) {
+          instr->super = super_CPXA_RESTO_DESVNZ;
+        } else if (p[1] == SUB) {
+          instr->super = super_CPXA_SUB_DESVNZ;
+        } else {
+          break;
+        }
+        instr->n_instr = 3;
+        instr->n_palavras = 5;
+        instr->args[0] = p[2];
+        instr->args[1] = p[4];
+      }
+      break;
+  }
+}
+
+#ifndef CPU_THREADED
+// retorna a função que implementa a instrução com o opcode dado
+static void (*decodifica(int opcode))(cpu_t *self)
+{
   switch (opcode) {
-    case NOP:    op_NOP(self);    break;
-    case PARA:   op_PARA(self);   break;
-    case CARGI:  op_CARGI(self);  break;
-    case CARGM:  op_CARGM(self);  break;
-    case CARGX:  op_CARGX(self);  break;
-    case ARMM:   op_ARMM(self);   break;
-    case ARMX:   op_ARMX(self);   break;
-    case TRAX:   op_TRAX(self);   break;
-    case CPXA:   op_CPXA(self);   break;
-    case INCX:   op_INCX(self);   break;
-    case SOMA:   op_SOMA(self);   break;
-    case SUB:    op_SUB(self);    break;
-    case MULT:   op_MULT(self);   break;
-    case DIV:    op_DIV(self);    break;
-    case RESTO:  op_RESTO(self);  break;
-    case NEG:    op_NEG(self);    break;
-    case DESV:   op_DESV(self);   break;
-    case DESVZ:  op_DESVZ(self);  break;
-    case DESVNZ: op_DESVNZ(self); break;
-    case DESVN:  op_DESVN(self);  break;
-    case DESVP:  op_DESVP(self);  break;
-    case CHAMA:  op_CHAMA(self);  break;
-    case RET:    op_RET(self);    break;
-    case LE:     op_LE(self);     break;
-    case ESCR:   op_ESCR(self);   break;
-    case RETI:   op_RETI(self);   break;
-    case CHAMAC: op_CHAMAC(self); break;
-    case CHAMAS: op_CHAMAS(self); break;
-    default:     self->erro = ERR_INSTR_INV;
+    case NOP:    return op_NOP;
+    case PARA:   return op_PARA;
+    case CARGI:  return op_CARGI;
+    case CARGM:  return op_CARGM;
+    case CARGX:  return op_CARGX;
+    case ARMM:   return op_ARMM;
+    case ARMX:   return op_ARMX;
+    case TRAX:   return op_TRAX;
+    case CPXA:   return op_CPXA;
+    case INCX:   return op_INCX;
+    case SOMA:   return op_SOMA;
+    case SUB:    return op_SUB;
+    case MULT:   return op_MULT;
+    case DIV:    return op_DIV;
+    case RESTO:  return op_RESTO;
+    case NEG:    return op_NEG;
+    case DESV:   return op_DESV;
+    case DESVZ:  return op_DESVZ;
+    case DESVNZ: return op_DESVNZ;
+    case DESVN:  return op_DESVN;
+    case DESVP:  return op_DESVP;
+    case CHAMA:  return op_CHAMA;
+    case RET:    return op_RET;
+    case LE:     return op_LE;
+    case ESCR:   return op_ESCR;
+    case RETI:   return op_RETI;
+    case CHAMAC: return op_CHAMAC;
+    case CHAMAS: return op_CHAMAS;
+    default:     return op_INV;
   }
+}
+#endif
+
+// retorna a instrução decodificada correspondente ao PC
+// se ela não estiver na cache de instruções, lê o opcode da memória,
+//   decodifica e coloca na cache
+// o PC é traduzido pela MMU a cada instrução, mesmo com a instrução na
+//   cache: é a tradução que gera as faltas de página e as violações de
+//   permissão de execução que o SO trata, e o mapeamento de uma página
+//   muda durante a execução (substituição, cópia na escrita, troca de
+//   processo); com a TLB, a tradução repetida custa pouco, e a cache,
+//   indexada por endereço físico, continua valendo para todos os processos
+//   que compartilham o quadro, coisa que um programa pré-traduzido por
+//   processo não faria
+// retorna NULL (e altera o estado da CPU) em caso de erro
+static decod_t *pega_instrucao(cpu_t *self)
+{
+  int endfis;
+  self->erro = mmu_traduz(self->mmu, self->PC, &endfis, self->modo);
+  if (self->erro != ERR_OK) {
+    self->complemento = self->PC;
+    return NULL;
+  }
+  decod_t *instr = &self->decod[endfis % N_DECOD];
+  if (instr->endfis == endfis) return instr;
 
+  int opcode;
+  if (!pega_opcode(self, &opcode)) return NULL;
+  instr->endfis = endfis;
+  instr->opcode = opcode;
+#ifdef CPU_THREADED
+  instr->rotulo = NULL;
+#else
+  instr->op = decodifica(opcode);
+#endif
+  instr->tem_A1 = false;
+  funde(self, instr);
+  return instr;
+}
+
+// chamada quando a memória no endereço físico 'endereco' é alterada
+// invalida a instrução que tem o opcode nesse endereço, e retira o que
+//   foi lido desse endereço das instruções anteriores (o argumento ou a
+//   superinstrução que inclui esse endereço)
+static void cpu_observa_mem(void *arg, int endereco)
+{
+  cpu_t *self = arg;
+  decod_t *instr = &self->decod[endereco % N_DECOD];
+  if (instr->endfis == endereco) {
+    instr->endfis = -1;
+  }
+  for (int d = 1; d < MAX_PALAVRAS_SUPER && d <= endereco; d++) {
+    instr = &self->decod[(endereco - d) % N_DECOD];
+    if (instr->endfis != endereco - d) continue;
+    if (d == 1) {
+      instr->tem_A1 = false;
+    }
+    if (instr->super != NULL && d < instr->n_palavras) {
+      instr->super = NULL;
+    }
+  }
+}
+
+// depois da execução de uma instrução, se ela causou erro em modo usuário,
+//   a CPU se interrompe para que o SO trate o erro
+static void verifica_erro(cpu_t *self)
+{
   if (self->erro != ERR_OK && self->erro != ERR_CPU_PARADA && self->modo == usuario) {
     cpu_interrompe(self, IRQ_ERR_CPU);
   }
 }
 
+#ifndef CPU_THREADED
+
+// executa até 'n' instruções
+// para antes se ocorrer um erro ou se o modo da CPU mudar (por uma
+//   interrupção ou um retorno de interrupção)
+// usa uma superinstrução quando ela couber nas instruções que faltam
+// retorna o número de instruções executadas (incluindo a que causou erro)
+static int executa(cpu_t *self, int n)
+{
+  cpu_modo_t modo = self->modo;
+  int executadas = 0;
+  while (executadas < n && self->erro == ERR_OK && self->modo == modo) {
+    decod_t *instr = pega_instrucao(self);
+    if (instr == NULL) {
+      executadas++;
+      verifica_erro(self);
+      break;
+    }
+    self->instr = instr;
+    if (instr->super != NULL && executadas + instr->n_instr <= n) {
+      executadas += instr->super(self, instr);
+    } else {
+      executadas++;
+      instr->op(self);
+    }
+    self->instr = NULL;
+    verifica_erro(self);
+  }
+  return executadas;
+}
+
+#else // CPU_THREADED
+
+// executa até 'n' instruções, como a versão acima, mas sem o laço com um
+//   ponto único de despacho: cada instrução tem seu trecho de código,
+//   identificado por um rótulo (o endereço do rótulo fica na cache de
+//   instruções), e cada trecho termina com a sua própria cópia da busca da
+//   instrução seguinte e do desvio indireto para o trecho dela (DESPACHA)
+// com um desvio indireto por instrução em vez de um só, o previsor de
+//   desvios da máquina hospedeira aprende qual instrução costuma vir depois
+//   de cada uma
+// as instruções que só mexem em registradores são feitas no próprio trecho;
+//   as que acessam memória ou E/S chamam a função op_ correspondente, que
+//   trata os erros
+// o despacho não é feito sobre uma cópia pré-traduzida do programa: as
+//   instruções vêm da mesma cache de instruções da versão com switch,
+//   preenchida à medida que são executadas, e o PC é traduzido pela MMU a
+//   cada instrução (ver pega_instrucao)
+// usa a extensão do gcc que permite pegar o endereço de um rótulo ("&&")
+//   e desviar para ele ("goto *")
+static int executa(cpu_t *self, int n)
+{
+  static const void *const rotulos[] = {
+    [NOP]    = &&l_NOP,    [PARA]   = &&l_PARA,   [CARGI]  = &&l_CARGI,
+    [CARGM]  = &&l_CARGM,  [CARGX]  = &&l_CARGX,  [ARMM]   = &&l_ARMM,
+    [ARMX]   = &&l_ARMX,   [TRAX]   = &&l_TRAX,   [CPXA]   = &&l_CPXA,
+    [INCX]   = &&l_INCX,   [SOMA]   = &&l_SOMA,   [SUB]    = &&l_SUB,
+    [MULT]   = &&l_MULT,   [DIV]    = &&l_DIV,    [RESTO]  = &&l_RESTO,
+    [NEG]    = &&l_NEG,    [DESV]   = &&l_DESV,   [DESVZ]  = &&l_DESVZ,
+    [DESVNZ] = &&l_DESVNZ, [DESVN]  = &&l_DESVN,  [DESVP]  = &&l_DESVP,
+    [CHAMA]  = &&l_CHAMA,  [RET]    = &&l_RET,    [LE]     = &&l_LE,
+    [ESCR]   = &&l_ESCR,   [RETI]   = &&l_RETI,   [CHAMAC] = &&l_CHAMAC,
+    [CHAMAS] = &&l_CHAMAS,
+  };
+  cpu_modo_t modo = self->modo;
+  int executadas = 0;
+  decod_t *instr;
+
+  // busca a instrução no PC e desvia para o trecho dela (ou para a
+  //   superinstrução); é expandido no fim de cada trecho
+  // o rótulo é colocado na entrada da cache na primeira execução
+#define DESPACHA                                                         \
+  do {                                                                   \
+    if (executadas >= n || self->erro != ERR_OK || self->modo != modo) { \
+      return executadas;                                                 \
+    }                                                                    \
+    instr = pega_instrucao(self);                                        \
+    if (instr == NULL) {                                                 \
+      verifica_erro(self);                                               \
+      return executadas + 1;                                             \
+    }                                                                    \
+    self->instr = instr;                                                 \
+    if (instr->super != NULL && executadas + instr->n_instr <= n) {      \
+      goto super;                                                        \
+    }                                                                    \
+    executadas++;                                                        \
+    if (instr->rotulo == NULL) {                                         \
+      if (instr->opcode >= 0 && instr->opcode <= CHAMAS) {               \
+        instr->rotulo = rotulos[instr->opcode];                          \
+      } else {                                                           \
+        instr->rotulo = &&l_INV;                                         \
+      }                                                                  \
+    }                                                                    \
+    goto *instr->rotulo;                                                 \
+  } while (0)
+
+  // termina a instrução atual e despacha a próxima
+#define PROXIMA                                                          \
+  self->instr = NULL;                                                    \
+  verifica_erro(self);                                                   \
+  DESPACHA
+
+  DESPACHA;
+
+super:    executadas += instr->super(self, instr); PROXIMA;
+l_NOP:    self->PC += 1; PROXIMA;
+l_PARA:   op_PARA(self);   PROXIMA;
+l_CARGI:  op_CARGI(self);  PROXIMA;
+l_CARGM:  op_CARGM(self);  PROXIMA;
+l_CARGX:  op_CARGX(self);  PROXIMA;
+l_ARMM:   op_ARMM(self);   PROXIMA;
+l_ARMX:   op_ARMX(self);   PROXIMA;
+l_TRAX:   { int A = self->A; self->A = self->X; self->X = A; }
+          self->PC += 1; PROXIMA;
+l_CPXA:   self->A = self->X; self->PC += 1; PROXIMA;
+l_INCX:   self->X += 1; self->PC += 1; PROXIMA;
+l_SOMA:   op_SOMA(self);   PROXIMA;
+l_SUB:    op_SUB(self);    PROXIMA;
+l_MULT:   op_MULT(self);   PROXIMA;
+l_DIV:    op_DIV(self);    PROXIMA;
+l_RESTO:  op_RESTO(self);  PROXIMA;
+l_NEG:    self->A = -self->A; self->PC += 1; PROXIMA;
+l_DESV:   op_DESV(self);   PROXIMA;
+l_DESVZ:  op_DESVZ(self);  PROXIMA;
+l_DESVNZ: op_DESVNZ(self); PROXIMA;
+l_DESVN:  op_DESVN(self);  PROXIMA;
+l_DESVP:  op_DESVP(self);  PROXIMA;
+l_CHAMA:  op_CHAMA(self);  PROXIMA;
+l_RET:    op_RET(self);    PROXIMA;
+l_LE:     op_LE(self);     PROXIMA;
+l_ESCR:   op_ESCR(self);   PROXIMA;
+l_RETI:   op_RETI(self);   PROXIMA;
+l_CHAMAC: op_CHAMAC(self); PROXIMA;
+l_CHAMAS: op_CHAMAS(self); PROXIMA;
+l_INV:    op_INV(self);    PROXIMA;
+#undef PROXIMA
+#undef DESPACHA
+}
+
+#endif // CPU_THREADED
+
+void cpu_executa_1(cpu_t *self)
+{
+  executa(self, 1);
+}
+
+int cpu_executa_n(cpu_t *self, int n)
+{
+  return executa(self, n);
+}
+
 bool cpu_interrompe(cpu_t *self, irq_t irq)
 {
   // só aceita interrupção em modo usuário
   if (self->modo != usuario) return false;
   // esta é uma CPU boazinha, salva todo o estado interno da CPU
   // poe em modo supervisor, para que o acesso seja feito na memória física
+  // o estado é montado antes, e escrito de uma vez
+  int estado[IRQ_N_END] = {
+    [IRQ_END_PC]          = self->PC,
+    [IRQ_END_A]           = self->A,
+    [IRQ_END_X]           = self->X,
+    [IRQ_END_erro]        = self->erro,
+    [IRQ_END_complemento] = self->complemento,
+    [IRQ_END_modo]        = usuario,
+  };
   self->modo = supervisor;
-  poe_mem(self, IRQ_END_PC,          self->PC);
-  poe_mem(self, IRQ_END_A,           self->A);
-  poe_mem(self, IRQ_END_X,           self->X);
-  poe_mem(self, IRQ_END_erro,        self->erro);
-  poe_mem(self, IRQ_END_complemento, self->complemento);
-  poe_mem(self, IRQ_END_modo,        usuario);
+  mmu_copia_para(self->mmu, IRQ_END_PC, IRQ_N_END, estado, supervisor, NULL);
 
   self->A = irq;
   self->erro = ERR_OK;
@@ -452,15 +864,15 @@ bool cpu_interrompe(cpu_t *self, irq_t irq)
 
 static void cpu_desinterrompe(cpu_t *self)
 {
-  int dado;
-  pega_mem(self, IRQ_END_PC,          &self->PC);
-  pega_mem(self, IRQ_END_A,           &self->A);
-  pega_mem(self, IRQ_END_X,           &self->X);
-  pega_mem(self, IRQ_END_erro,        &dado);
-  self->erro = dado;
-  pega_mem(self, IRQ_END_complemento, &self->complemento);
-  pega_mem(self, IRQ_END_modo,        &dado);
-  self->modo = dado;
+  // o estado é lido de uma vez, no modo supervisor em que a CPU está
+  int estado[IRQ_N_END];
+  mmu_copia_de(self->mmu, IRQ_END_PC, IRQ_N_END, estado, self->modo, NULL);
+  self->PC = estado[IRQ_END_PC];
+  self->A = estado[IRQ_END_A];
+  self->X = estado[IRQ_END_X];
+  self->erro = estado[IRQ_END_erro];
+  self->complemento = estado[IRQ_END_complemento];
+  self->modo = estado[IRQ_END_modo];
 }
 
 void cpu_define_chamaC(cpu_t *self, func_chamaC_t funcaoC, void *argC)
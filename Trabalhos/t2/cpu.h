@@ -30,6 +30,14 @@ void cpu_destroi(cpu_t *self);
 // executa uma instrução
 void cpu_executa_1(cpu_t *self);
 
+// executa até 'n' instruções, sem parar entre elas
+// para antes se uma instrução causar erro ou se o modo da CPU mudar (a CPU
+//   aceitou uma interrupção ou retornou de uma)
+// retorna o número de instruções executadas (0 se a CPU já estava em erro)
+// quem chama deve limitar 'n' para não passar de algum evento que tenha que
+//   ser atendido entre duas instruções (uma interrupção do relógio, p. ex.)
+int cpu_executa_n(cpu_t *self, int n);
+
 // implementa uma interrupção
 // passa para modo supervisor, salva o estado da CPU no início da memória,
 //   altera A para identificar a requisição de interrupção, altera PC para
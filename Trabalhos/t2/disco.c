@@ -0,0 +1,152 @@
+#include "disco.h"
+#include <stdlib.h>
+
+struct disco_t {
+  mem_t *conteudo;       // as palavras guardadas no disco
+  mem_t *mem;            // memória principal, origem ou destino dos dados
+  int latencia;          // duração de uma transferência
+  // registradores da transferência
+  int end_disco;
+  int end_mem;
+  int tam;
+  int comando;           // transferência em andamento, 0 se nenhuma
+  int t_ate_fim;         // quanto tempo falta para terminar a transferência
+  err_t resultado;       // resultado da última transferência
+  int interrupcao;       // 1 se está gerando interrupção, 0 se não
+};
+
+disco_t *disco_cria(int tam, mem_t *mem, int latencia)
+{
+  disco_t *self = malloc(sizeof(*self));
+  if (self == NULL) return NULL;
+  self->conteudo = mem_cria(tam);
+  if (self->conteudo == NULL) {
+    free(self);
+    return NULL;
+  }
+  self->mem = mem;
+  self->latencia = latencia;
+  self->end_disco = 0;
+  self->end_mem = 0;
+  self->tam = 0;
+  self->comando = 0;
+  self->t_ate_fim = 0;
+  self->resultado = ERR_OK;
+  self->interrupcao = 0;
+  return self;
+}
+
+void disco_destroi(disco_t *self)
+{
+  mem_destroi(self->conteudo);
+  free(self);
+}
+
+mem_t *disco_conteudo(disco_t *self)
+{
+  return self->conteudo;
+}
+
+// realiza a cópia dos dados da transferência em andamento
+static void disco_transfere(disco_t *self)
+{
+  mem_t *origem = self->conteudo;
+  mem_t *destino = self->mem;
+  int end_origem = self->end_disco;
+  int end_destino = self->end_mem;
+  if (self->comando == DISCO_GRAVA) {
+    origem = self->mem;
+    destino = self->conteudo;
+    end_origem = self->end_mem;
+    end_destino = self->end_disco;
+  }
+  const int *dados = mem_trecho(origem, end_origem, self->tam);
+  if (dados == NULL) {
+    self->resultado = ERR_END_INV;
+  } else {
+    self->resultado = mem_copia_para(destino, end_destino, self->tam, dados);
+  }
+  self->comando = 0;
+  self->interrupcao = 1;
+}
+
+void disco_avanca(disco_t *self, int n)
+{
+  if (self->comando == 0) return;
+  if (self->t_ate_fim > n) {
+    self->t_ate_fim -= n;
+  } else {
+    self->t_ate_fim = 0;
+    disco_transfere(self);
+  }
+}
+
+err_t disco_le(void *disp, int id, int *pvalor)
+{
+  disco_t *self = disp;
+  err_t err = ERR_OK;
+  switch (id) {
+    case 0:
+      *pvalor = self->end_disco;
+      break;
+    case 1:
+      *pvalor = self->end_mem;
+      break;
+    case 2:
+      *pvalor = self->tam;
+      break;
+    case 3:
+      *pvalor = self->comando != 0;
+      break;
+    case 4:
+      *pvalor = self->t_ate_fim;
+      break;
+    case 5:
+      *pvalor = self->interrupcao;
+      break;
+    case 6:
+      *pvalor = self->resultado;
+      break;
+    default:
+      err = ERR_END_INV;
+  }
+  return err;
+}
+
+err_t disco_escr(void *disp, int id, int valor)
+{
+  disco_t *self = disp;
+  err_t err = ERR_OK;
+  switch (id) {
+    case 0:
+      self->end_disco = valor;
+      break;
+    case 1:
+      self->end_mem = valor;
+      break;
+    case 2:
+      self->tam = valor;
+      break;
+    case 3:
+      if (self->comando != 0) {
+        err = ERR_OCUP;
+      } else if (valor != DISCO_LE && valor != DISCO_GRAVA) {
+        err = ERR_OP_INV;
+      } else {
+        self->comando = valor;
+        self->t_ate_fim = self->latencia;
+        // sem latência, a transferência é feita na hora
+        if (self->t_ate_fim <= 0) {
+          self->t_ate_fim = 0;
+          disco_transfere(self);
+        }
+      }
+      break;
+    case 5:
+      self->interrupcao = (valor == 0) ? 0 : 1;
+      break;
+    default:
+      err = ERR_END_INV;
+  }
+  return err;
+}
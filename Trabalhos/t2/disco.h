@@ -0,0 +1,55 @@
+#ifndef DISCO_H
+#define DISCO_H
+
+// simulador de um disco, usado como memória secundária (swap)
+// transfere blocos de palavras entre o disco e a memória principal (DMA)
+// uma transferência demora um número configurável de unidades de tempo;
+//   quando termina, o disco pede uma interrupção
+// faz uma transferência de cada vez
+
+#include "err.h"
+#include "memoria.h"
+
+typedef struct disco_t disco_t;
+
+// comandos que podem ser escritos no dispositivo 3
+#define DISCO_LE    1   // copia do disco para a memória principal
+#define DISCO_GRAVA 2   // copia da memória principal para o disco
+
+// cria um disco com 'tam' palavras, que transfere dados de e para 'mem'
+// cada transferência demora 'latencia' unidades de tempo
+// retorna NULL em caso de erro
+disco_t *disco_cria(int tam, mem_t *mem, int latencia);
+
+// destrói um disco
+// nenhuma outra operação pode ser realizada no disco após esta chamada
+void disco_destroi(disco_t *self);
+
+// registra a passagem de 'n' unidades de tempo
+// se a transferência em andamento terminar nesse tempo, ela é realizada e
+//   o disco passa a pedir interrupção
+void disco_avanca(disco_t *self, int n);
+
+// acesso direto ao conteúdo do disco, sem passar tempo
+// serve para colocar dados no disco sem ser por transferência com a memória
+//   principal (como na instalação de um programa)
+mem_t *disco_conteudo(disco_t *self);
+
+// Funções para acessar o disco como um dispositivo de E/S
+//   tem sete dispositivos:
+//   '0' para ler ou escrever o endereço no disco da transferência
+//   '1' para ler ou escrever o endereço na memória principal da transferência
+//   '2' para ler ou escrever o número de palavras a transferir
+//   '3' para escrever um comando (DISCO_LE ou DISCO_GRAVA), que inicia uma
+//       transferência com os valores dos dispositivos 0 a 2, ou para ler se
+//       o disco está ocupado (1) ou não (0); escrever um comando com o disco
+//       ocupado resulta em ERR_OCUP
+//   '4' para ler em quanto tempo a transferência em andamento vai terminar
+//       (0 se não tem transferência em andamento)
+//   '5' para ler ou escrever se uma interrupção está sendo pedida
+//   '6' para ler o resultado da última transferência (ERR_OK ou o erro de
+//       acesso à memória)
+err_t disco_le(void *disp, int id, int *pvalor);
+err_t disco_escr(void *disp, int id, int valor);
+
+#endif // DISCO_H
@@ -7,6 +7,7 @@ static char *nomes[N_IRQ] = {
   [IRQ_RELOGIO] = "E/S: relógio",
   [IRQ_TECLADO] = "E/S: teclado",
   [IRQ_TELA]    = "E/S: console",
+  [IRQ_DISCO]   = "E/S: disco",
 };
 
 // retorna o nome da interrupção
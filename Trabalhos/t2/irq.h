@@ -11,6 +11,7 @@ typedef enum {
   IRQ_RELOGIO,       // interrupção causada pelo relógio
   IRQ_TECLADO,       // interrupção causada pelo teclado
   IRQ_TELA,          // interrupção causada pela tela
+  IRQ_DISCO,         // fim de transferência do disco
   N_IRQ              // número de interrupções
 } irq_t;
 
@@ -22,5 +23,6 @@ char *irq_nome(irq_t irq);
 #define IRQ_END_erro        3
 #define IRQ_END_complemento 4
 #define IRQ_END_modo        5
+#define IRQ_N_END           6  // número de posições do estado salvo
 
 #endif // IRQ_H
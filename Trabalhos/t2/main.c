@@ -5,13 +5,20 @@
 #include "cpu.h"
 #include "relogio.h"
 #include "console.h"
+#include "disco.h"
 #include "so.h"
+#include "tabpag.h"
 
+#include <stdbool.h>
 #include <stdio.h>
+#include <limits.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 // constantes
-#define MEM_TAM 10000        // tamanho da memória principal
+#define MEM_TAM 10000        // tamanho padrão da memória principal
+#define DISCO_TAM 100000     // tamanho do disco (memória secundária)
+#define DISCO_LATENCIA 100   // duração padrão de uma transferência do disco
 
 
 typedef struct {
@@ -20,19 +27,35 @@ typedef struct {
   cpu_t *cpu;
   relogio_t *relogio;
   console_t *console;
+  disco_t *disco;
   es_t *es;
   controle_t *controle;
 } hardware_t;
 
-void cria_hardware(hardware_t *hw)
+// retorna false se não foi possível criar a memória, a MMU ou o disco
+bool cria_hardware(hardware_t *hw, int mem_tam, int tam_pagina,
+                   int latencia_disco)
 {
   // cria a memória e a MMU
-  hw->mem = mem_cria(MEM_TAM);
-  hw->mmu = mmu_cria(hw->mem);
+  hw->mem = mem_cria(mem_tam);
+  if (hw->mem == NULL) return false;
+  hw->mmu = mmu_cria(hw->mem, tam_pagina);
+  if (hw->mmu == NULL) {
+    mem_destroi(hw->mem);
+    return false;
+  }
 
   // cria dispositivos de E/S
   hw->console = console_cria();
   hw->relogio = rel_cria();
+  hw->disco = disco_cria(DISCO_TAM, hw->mem, latencia_disco);
+  if (hw->disco == NULL) {
+    rel_destroi(hw->relogio);
+    console_destroi(hw->console);
+    mmu_destroi(hw->mmu);
+    mem_destroi(hw->mem);
+    return false;
+  }
 
   // cria o controlador de E/S e registra os dispositivos
   hw->es = es_cria();
@@ -49,12 +72,23 @@ void cria_hardware(hardware_t *hw)
   // lê relógio virtual, relógio real
   es_registra_dispositivo(hw->es, 8, hw->relogio, 0, rel_le, NULL);
   es_registra_dispositivo(hw->es, 9, hw->relogio, 1, rel_le, NULL);
+  // endereço no disco, endereço na memória, tamanho, comando/ocupado,
+  //   tempo até o fim, interrupção, resultado da transferência do disco
+  es_registra_dispositivo(hw->es, 10, hw->disco, 0, disco_le, disco_escr);
+  es_registra_dispositivo(hw->es, 11, hw->disco, 1, disco_le, disco_escr);
+  es_registra_dispositivo(hw->es, 12, hw->disco, 2, disco_le, disco_escr);
+  es_registra_dispositivo(hw->es, 13, hw->disco, 3, disco_le, disco_escr);
+  es_registra_dispositivo(hw->es, 14, hw->disco, 4, disco_le, NULL);
+  es_registra_dispositivo(hw->es, 15, hw->disco, 5, disco_le, disco_escr);
+  es_registra_dispositivo(hw->es, 16, hw->disco, 6, disco_le, NULL);
 
   // cria a unidade de execução e inicializa com a MMU e E/S
   hw->cpu = cpu_cria(hw->mmu, hw->es);
 
   // cria o controlador e inicializa com a CPU
-  hw->controle = controle_cria(hw->cpu, hw->console, hw->relogio);
+  hw->controle = controle_cria(hw->cpu, hw->console, hw->relogio,
+                               hw->disco);
+  return true;
 }
 
 void destroi_hardware(hardware_t *hw)
@@ -62,27 +96,155 @@ void destroi_hardware(hardware_t *hw)
   controle_destroi(hw->controle);
   cpu_destroi(hw->cpu);
   es_destroi(hw->es);
+  disco_destroi(hw->disco);
   rel_destroi(hw->relogio);
   console_destroi(hw->console);
   mmu_destroi(hw->mmu);
   mem_destroi(hw->mem);
 }
 
-int main()
+// converte o argumento de uma opção em número, colocando em '*pnum'
+// retorna false se não for um número inteiro (ou não couber em um int)
+static bool converte_numero(char *str, int *pnum)
+{
+  char *fim;
+  long num = strtol(str, &fim, 10);
+  if (fim == str || *fim != '\0' || num < INT_MIN || num > INT_MAX) {
+    return false;
+  }
+  *pnum = num;
+  return true;
+}
+
+// opções da linha de comando:
+//   -m tam  tamanho da memória principal, em palavras (a memória só ocupa
+//           espaço no hospedeiro à medida que é usada); no máximo
+//           TABPAG_MAX_QUADRO + 1 quadros, ou seja, 2^27 vezes o tamanho
+//           da página (com a página padrão de 10, até 1342177280 palavras)
+//   -p tam  tamanho da página (e do quadro), em palavras
+//   -d lat  duração de uma transferência do disco, em instruções
+//   -t tau  tamanho do conjunto de trabalho, em interrupções de relógio
+//   -s alg  algoritmo de substituição de páginas (fifo, sc, lru, wsclock)
+int main(int argc, char *argv[])
 {
   hardware_t hw;
   so_t *so;
+  int mem_tam = MEM_TAM;
+  int tam_pagina = TAM_PAGINA;
+  int latencia_disco = DISCO_LATENCIA;
+  int tau = 0;
+  bool tem_tau = false;
+  char *nome_subst = NULL;
+
+  int opt;
+  bool ok = true;
+  while (ok && (opt = getopt(argc, argv, "m:p:d:t:s:")) != -1) {
+    switch (opt) {
+      case 'm':
+        ok = converte_numero(optarg, &mem_tam);
+        break;
+      case 'p':
+        ok = converte_numero(optarg, &tam_pagina);
+        break;
+      case 'd':
+        ok = converte_numero(optarg, &latencia_disco);
+        break;
+      case 't':
+        ok = converte_numero(optarg, &tau);
+        tem_tau = true;
+        break;
+      case 's':
+        nome_subst = optarg;
+        break;
+      default:
+        ok = false;
+        break;
+    }
+  }
+  if (!ok) {
+    fprintf(stderr, "uso: %s [-m tam_memoria] [-p tam_pagina]"
+                    " [-d latencia_disco] [-t tau]"
+                    " [-s fifo|sc|lru|wsclock]\n"
+                    "  tam_memoria: até %d quadros de tam_pagina palavras\n",
+            argv[0], TABPAG_MAX_QUADRO + 1);
+    return 1;
+  }
+  subst_alg_t subst = SUBST_WSCLOCK;
+  if (nome_subst != NULL && !subst_alg_de_nome(nome_subst, &subst)) {
+    fprintf(stderr, "%s: algoritmo de substituição desconhecido: %s\n",
+            argv[0], nome_subst);
+    return 1;
+  }
+  if (mem_tam < 100) {
+    fprintf(stderr, "%s: tamanho de memória inválido: %d\n", argv[0],
+            mem_tam);
+    return 1;
+  }
+  if (latencia_disco < 0) {
+    fprintf(stderr, "%s: latência de disco inválida: %d\n", argv[0],
+            latencia_disco);
+    return 1;
+  }
+  if (tem_tau && tau < 0) {
+    fprintf(stderr, "%s: tamanho do conjunto de trabalho inválido: %d\n",
+            argv[0], tau);
+    return 1;
+  }
+  if (tam_pagina < 1 || tam_pagina > mem_tam) {
+    fprintf(stderr, "%s: tamanho de página inválido: %d\n", argv[0],
+            tam_pagina);
+    return 1;
+  }
+  // o número do último quadro tem que caber no descritor de página
+  if (mem_tam / tam_pagina - 1 > TABPAG_MAX_QUADRO) {
+    fprintf(stderr, "%s: memória de %d palavras tem quadros demais para"
+                    " páginas de %d (máximo %d quadros)\n", argv[0],
+            mem_tam, tam_pagina, TABPAG_MAX_QUADRO + 1);
+    return 1;
+  }
 
   // cria o hardware
-  cria_hardware(&hw);
+  if (!cria_hardware(&hw, mem_tam, tam_pagina, latencia_disco)) {
+    fprintf(stderr, "%s: não foi possível criar o hardware (memória de %d"
+                    " palavras)\n", argv[0], mem_tam);
+    return 1;
+  }
   // cria o sistema operacional
-  so = so_cria(hw.cpu, hw.mem, hw.mmu, hw.console, hw.relogio);
+  so = so_cria(hw.cpu, hw.mem, hw.mmu, hw.console, hw.relogio, hw.disco);
+  if (so == NULL) {
+    destroi_hardware(&hw);
+    fprintf(stderr, "%s: não foi possível criar o SO (memória de %d palavras"
+                    " com páginas de %d)\n", argv[0], mem_tam, tam_pagina);
+    return 1;
+  }
+  if (tem_tau) {
+    so_define_tau(so, tau);
+  }
+  if (nome_subst != NULL && !so_define_subst(so, subst)) {
+    so_destroi(so);
+    destroi_hardware(&hw);
+    fprintf(stderr, "%s: não foi possível usar o algoritmo de substituição"
+                    " %s\n", argv[0], subst_nome(subst));
+    return 1;
+  }
   
   // executa o laço de execução da CPU
   controle_laco(hw.controle);
 
+  long acertos, faltas, descartes;
+  mmu_estatisticas_tlb(hw.mmu, &acertos, &faltas, &descartes);
+  console_printf(hw.console, "TLB: %ld acertos, %ld faltas, %ld descartes",
+                 acertos, faltas, descartes);
+  console_printf(hw.console, "memória: %d palavras, %ld alocadas",
+                 mem_tam, mem_residente(hw.mem));
+  prog_estatisticas_cache(&acertos, &faltas);
+  console_printf(hw.console, "cache de programas: %ld acertos, %ld faltas",
+                 acertos, faltas);
+  so_imprime_estatisticas(so);
+
   // destroi tudo
   so_destroi(so);
+  prog_esvazia_cache();
   destroi_hardware(&hw);
   return 0;
 }
@@ -1,10 +1,20 @@
 #include "memoria.h"
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 // tipo de dados opaco para representar uma região de memória
+// o conteúdo é um mapeamento anônimo, só reservado: o sistema hospedeiro
+//   só aloca uma página (dele) quando ela é tocada pela primeira vez, e
+//   até lá ela tem zeros; uma memória grande pouco usada não custa nada
 struct mem_t {
   int tam;
   int *conteudo;
+  size_t tam_mapa;
+  // quem deve ser avisado das alterações
+  mem_observador_t observador;
+  void *arg_observador;
 };
 
 mem_t *mem_cria(int tam)
@@ -13,7 +23,15 @@ mem_t *mem_cria(int tam)
   self = malloc(sizeof(*self));
   if (self != NULL) {
     self->tam = tam;
-    self->conteudo = malloc(tam * sizeof(*(self->conteudo)));
+    self->observador = NULL;
+    self->arg_observador = NULL;
+    self->tam_mapa = (size_t)tam * sizeof(*(self->conteudo));
+    self->conteudo = NULL;
+    if (tam > 0) {
+      void *mapa = mmap(NULL, self->tam_mapa, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+      if (mapa != MAP_FAILED) self->conteudo = mapa;
+    }
     if (self->conteudo == NULL) {
       free(self);
       self = NULL;
@@ -26,7 +44,7 @@ void mem_destroi(mem_t *self)
 {
   if (self != NULL) {
     if (self->conteudo != NULL) {
-      free(self->conteudo);
+      munmap(self->conteudo, self->tam_mapa);
     }
     free(self);
   }
@@ -37,6 +55,25 @@ int mem_tam(mem_t *self)
   return self->tam;
 }
 
+long mem_residente(mem_t *self)
+{
+  long tam_pag = sysconf(_SC_PAGESIZE);
+  size_t n_pags = (self->tam_mapa + tam_pag - 1) / tam_pag;
+  unsigned char *vet = malloc(n_pags);
+  if (vet == NULL) return -1;
+  long residente = -1;
+  if (mincore(self->conteudo, self->tam_mapa, vet) == 0) {
+    residente = 0;
+    for (size_t i = 0; i < n_pags; i++) {
+      if (vet[i] & 1) residente += tam_pag;
+    }
+    if (residente > (long)self->tam_mapa) residente = self->tam_mapa;
+    residente /= sizeof(*(self->conteudo));
+  }
+  free(vet);
+  return residente;
+}
+
 // função auxiliar, verifica se endereço é válido
 static err_t verif_permissao(mem_t *self, int endereco)
 {
@@ -60,6 +97,75 @@ err_t mem_escreve(mem_t *self, int endereco, int valor)
   err_t err = verif_permissao(self, endereco);
   if (err == ERR_OK) {
     self->conteudo[endereco] = valor;
+    if (self->observador != NULL) {
+      self->observador(self->arg_observador, endereco);
+    }
   }
   return err;
 }
+
+// função auxiliar, verifica se todo o trecho é válido
+static err_t verif_trecho(mem_t *self, int endereco, int n)
+{
+  if (n < 0 || endereco < 0 || endereco > self->tam - n) {
+    return ERR_END_INV;
+  }
+  return ERR_OK;
+}
+
+// avisa o observador da alteração das 'n' posições a partir de 'endereco'
+static void avisa_trecho(mem_t *self, int endereco, int n)
+{
+  if (self->observador != NULL) {
+    for (int i = 0; i < n; i++) {
+      self->observador(self->arg_observador, endereco + i);
+    }
+  }
+}
+
+err_t mem_copia_de(mem_t *self, int endereco, int n, int dest[n])
+{
+  err_t err = verif_trecho(self, endereco, n);
+  if (err == ERR_OK) {
+    memcpy(dest, &self->conteudo[endereco], n * sizeof(int));
+  }
+  return err;
+}
+
+err_t mem_copia_para(mem_t *self, int endereco, int n, const int orig[n])
+{
+  err_t err = verif_trecho(self, endereco, n);
+  if (err == ERR_OK) {
+    memcpy(&self->conteudo[endereco], orig, n * sizeof(int));
+    avisa_trecho(self, endereco, n);
+  }
+  return err;
+}
+
+err_t mem_preenche(mem_t *self, int endereco, int n, int valor)
+{
+  err_t err = verif_trecho(self, endereco, n);
+  if (err == ERR_OK) {
+    if (valor == 0) {
+      memset(&self->conteudo[endereco], 0, n * sizeof(int));
+    } else {
+      for (int i = 0; i < n; i++) {
+        self->conteudo[endereco + i] = valor;
+      }
+    }
+    avisa_trecho(self, endereco, n);
+  }
+  return err;
+}
+
+const int *mem_trecho(mem_t *self, int endereco, int n)
+{
+  if (verif_trecho(self, endereco, n) != ERR_OK) return NULL;
+  return &self->conteudo[endereco];
+}
+
+void mem_define_observador(mem_t *self, mem_observador_t func, void *arg)
+{
+  self->observador = func;
+  self->arg_observador = arg;
+}
@@ -2,13 +2,18 @@
 #define MEMORIA_H
 
 // simulador da memória principal
-// é um vetor de inteiros
+// é um vetor de inteiros, que começa todo com zero
+// a memória é alocada no sistema hospedeiro só quando é usada, então
+//   pode ser criada bem maior que o usado (milhões de valores)
 
 #include "err.h"
 
 // tipo opaco que representa a memória
 typedef struct mem_t mem_t;
 
+// tipo da função chamada quando uma posição da memória é alterada
+typedef void (*mem_observador_t)(void *arg, int endereco);
+
 // cria uma região de memória com capacidade para 'tam' valores (inteiros)
 // retorna um ponteiro para um descritor, que deverá ser usado em todas
 //   as operações sobre essa memória
@@ -22,6 +27,11 @@ void mem_destroi(mem_t *self);
 // retorna o tamanho da região de memória (número de valores que comporta)
 int mem_tam(mem_t *self);
 
+// retorna quantos valores da região estão efetivamente alocados no
+//   sistema hospedeiro (a alocação é feita em páginas do hospedeiro, a
+//   partir do primeiro acesso a cada uma), ou -1 se não for possível saber
+long mem_residente(mem_t *self);
+
 // coloca na posição apontada por 'pvalor' o valor no endereço 'endereco'
 // retorna erro ERR_END_INV (e não altera '*pvalor') se endereço inválido
 err_t mem_le(mem_t *self, int endereco, int *pvalor);
@@ -30,4 +40,34 @@ err_t mem_le(mem_t *self, int endereco, int *pvalor);
 // retorna erro ERR_END_INV se endereço inválido
 err_t mem_escreve(mem_t *self, int endereco, int valor);
 
+// operações em trechos da memória
+// o trecho de 'n' valores a partir de 'endereco' é validado uma vez, e os
+//   valores são copiados de uma vez; se alguma posição do trecho for
+//   inválida, nada é feito, e é retornado ERR_END_INV
+
+// copia para 'dest' os 'n' valores a partir de 'endereco'
+err_t mem_copia_de(mem_t *self, int endereco, int n, int dest[n]);
+
+// copia os 'n' valores de 'orig' para a memória a partir de 'endereco'
+// o observador (se houver) é avisado de cada endereço alterado
+err_t mem_copia_para(mem_t *self, int endereco, int n, const int orig[n]);
+
+// coloca 'valor' nas 'n' posições a partir de 'endereco'
+// o observador (se houver) é avisado de cada endereço alterado
+err_t mem_preenche(mem_t *self, int endereco, int n, int valor);
+
+// retorna um ponteiro para os 'n' valores a partir de 'endereco', para
+//   serem lidos sem cópia, ou NULL se o trecho não for válido
+// o ponteiro vale enquanto a memória existir, e vê as alterações feitas
+//   depois; não pode ser usado para alterar a memória (o observador não
+//   seria avisado)
+const int *mem_trecho(mem_t *self, int endereco, int n);
+
+// define uma função a ser chamada após cada escrita bem sucedida na memória,
+//   com o endereço alterado e o argumento 'arg'
+// serve para quem mantém cópias de partes da memória (uma cache) saber
+//   quando elas ficaram desatualizadas
+// só existe um observador; se 'func' for NULL, não chama ninguém
+void mem_define_observador(mem_t *self, mem_observador_t func, void *arg);
+
 #endif // MEMORIA_H
@@ -1,33 +1,252 @@
 #include "mmu.h"
 #include <stdlib.h>
 
+// TLB (translation lookaside buffer)
+// guarda as traduções mais recentes de página para quadro, para não
+//   consultar a tabela de páginas a cada acesso
+// é associativa por conjunto: a página só pode estar no conjunto
+//   'pagina % TLB_N_CONJ', em qualquer uma de suas TLB_N_VIAS entradas
+#define TLB_N_CONJ 16
+#define TLB_N_VIAS 4
+
+// número de espaços de endereçamento (tabelas de páginas) cujas traduções
+//   podem estar ao mesmo tempo na TLB
+// cada entrada da TLB é marcada com o identificador do espaço (asid) da
+//   tabela de onde veio a tradução, e só vale para esse espaço; trocar de
+//   tabela não esvazia a TLB, a não ser que a tabela nova não tenha
+//   identificador e seja preciso tirar o de outra
+#define MMU_N_ESPACOS 8
+
+// os bits de acesso e alteração da tabela de páginas só são marcados no
+//   primeiro acesso (ou primeira escrita) à página depois que a entrada
+//   entra na TLB; quando a tabela zera o bit de acesso, avisa a MMU, que
+//   descarta a entrada, e o próximo acesso volta a marcar
+typedef struct {
+  int pagina;     // página virtual traduzida, -1 se a entrada estiver livre
+  int asid;       // espaço de endereçamento da página
+  int base;       // endereço físico do início do quadro dessa página
+  bool acessada;  // o bit de acesso já foi marcado na tabela
+  bool alterada;  // o bit de alteração já foi marcado na tabela
+  int permissoes; // o que a página permite além da leitura (ver perm_t)
+} tlb_entrada_t;
+
+// espaço de endereçamento conhecido pela MMU; o identificador (asid) é a
+//   posição no vetor de espaços
+// é o argumento do observador da tabela (ver tabpag_define_observador)
+typedef struct {
+  mmu_t *mmu;
+  tabpag_t *tabpag;  // NULL se o identificador está livre
+} espaco_t;
+
 // tipo de dados opaco para representar uma MMU
 struct mmu_t {
   mem_t *mem;
   tabpag_t *tabpag;
+  int asid;         // identificador do espaço de tabpag
+  espaco_t espacos[MMU_N_ESPACOS];
+  int espaco_vitima;  // próximo identificador a tirar de uma tabela
+  int tam_pagina;
+  int bits_pagina;  // log2(tam_pagina) se for potência de 2, senão -1
+  tlb_entrada_t tlb[TLB_N_CONJ][TLB_N_VIAS];
+  int tlb_vitima[TLB_N_CONJ];  // próxima via a substituir, em cada conjunto
+  long tlb_acertos;
+  long tlb_faltas;
+  long tlb_descartes;
 };
 
-mmu_t *mmu_cria(mem_t *mem)
+static void mmu__esvazia_tlb(mmu_t *self)
+{
+  for (int conj = 0; conj < TLB_N_CONJ; conj++) {
+    for (int via = 0; via < TLB_N_VIAS; via++) {
+      self->tlb[conj][via].pagina = -1;
+      self->tlb[conj][via].asid = -1;
+    }
+    self->tlb_vitima[conj] = 0;
+  }
+}
+
+mmu_t *mmu_cria(mem_t *mem, int tam_pagina)
 {
+  if (tam_pagina < 1) return NULL;
   mmu_t *self;
   self = malloc(sizeof(*self));
   if (self != NULL) {
     self->mem = mem;
     self->tabpag = NULL;
+    self->asid = -1;
+    for (int asid = 0; asid < MMU_N_ESPACOS; asid++) {
+      self->espacos[asid].mmu = self;
+      self->espacos[asid].tabpag = NULL;
+    }
+    self->espaco_vitima = 0;
+    self->tam_pagina = tam_pagina;
+    self->bits_pagina = -1;
+    if ((tam_pagina & (tam_pagina - 1)) == 0) {
+      self->bits_pagina = 0;
+      while ((1 << self->bits_pagina) < tam_pagina) self->bits_pagina++;
+    }
+    mmu__esvazia_tlb(self);
+    self->tlb_acertos = 0;
+    self->tlb_faltas = 0;
+    self->tlb_descartes = 0;
   }
   return self;
 }
 
+int mmu_tam_pagina(mmu_t *self)
+{
+  return self->tam_pagina;
+}
+
+// separa um endereço virtual (não negativo) em página e deslocamento
+static inline void mmu__separa(mmu_t *self, int endvirt,
+                               int *ppagina, int *pdesloc)
+{
+  if (self->bits_pagina >= 0) {
+    *ppagina = endvirt >> self->bits_pagina;
+    *pdesloc = endvirt & (self->tam_pagina - 1);
+  } else {
+    *ppagina = endvirt / self->tam_pagina;
+    *pdesloc = endvirt % self->tam_pagina;
+  }
+}
+
 void mmu_destroi(mmu_t *self)
 {
   if (self != NULL) {
+    for (int asid = 0; asid < MMU_N_ESPACOS; asid++) {
+      if (self->espacos[asid].tabpag != NULL) {
+        tabpag_define_observador(self->espacos[asid].tabpag, NULL, NULL);
+      }
+    }
     free(self);
   }
 }
 
+// conjunto da TLB onde pode estar a tradução de 'pagina' no espaço 'asid'
+// o deslocamento pelo asid faz as páginas de mesmo número de espaços
+//   diferentes (todos os programas começam na página 0) caírem em
+//   conjuntos diferentes
+static inline int mmu__conjunto(int pagina, int asid)
+{
+  return (pagina + 5 * asid) % TLB_N_CONJ;
+}
+
+// descarta da TLB todas as traduções do espaço 'asid'
+static void mmu__descarta_espaco(mmu_t *self, int asid)
+{
+  for (int conj = 0; conj < TLB_N_CONJ; conj++) {
+    for (int via = 0; via < TLB_N_VIAS; via++) {
+      if (self->tlb[conj][via].asid == asid) {
+        self->tlb[conj][via].pagina = -1;
+      }
+    }
+  }
+  self->tlb_descartes++;
+}
+
+// chamada pela tabela de páginas de um espaço quando a tradução de
+//   'pagina' muda, ou com -1 quando a tabela vai ser destruída
+static void mmu__observa_tabpag(void *arg, int pagina)
+{
+  espaco_t *espaco = arg;
+  mmu_t *self = espaco->mmu;
+  int asid = espaco - self->espacos;
+  if (pagina < 0) {
+    // o identificador fica livre para outra tabela
+    mmu__descarta_espaco(self, asid);
+    espaco->tabpag = NULL;
+    if (self->asid == asid) {
+      self->tabpag = NULL;
+      self->asid = -1;
+    }
+    return;
+  }
+  tlb_entrada_t *conj = self->tlb[mmu__conjunto(pagina, asid)];
+  for (int via = 0; via < TLB_N_VIAS; via++) {
+    if (conj[via].pagina == pagina && conj[via].asid == asid) {
+      conj[via].pagina = -1;
+    }
+  }
+}
+
 void mmu_define_tabpag(mmu_t *self, tabpag_t *tabpag)
 {
   self->tabpag = tabpag;
+  self->asid = -1;
+  if (tabpag == NULL) return;
+  // se a tabela já tem identificador, suas traduções podem estar na TLB
+  int livre = -1;
+  for (int asid = 0; asid < MMU_N_ESPACOS; asid++) {
+    if (self->espacos[asid].tabpag == tabpag) {
+      self->asid = asid;
+      return;
+    }
+    if (livre == -1 && self->espacos[asid].tabpag == NULL) livre = asid;
+  }
+  // tabela nova: usa um identificador livre, ou tira o de outra tabela,
+  //   descartando as traduções dela
+  int asid = livre;
+  if (asid == -1) {
+    asid = self->espaco_vitima;
+    self->espaco_vitima = (asid + 1) % MMU_N_ESPACOS;
+    tabpag_define_observador(self->espacos[asid].tabpag, NULL, NULL);
+    mmu__descarta_espaco(self, asid);
+  }
+  self->espacos[asid].tabpag = tabpag;
+  tabpag_define_observador(tabpag, mmu__observa_tabpag, &self->espacos[asid]);
+  self->asid = asid;
+}
+
+// traduz 'endvirt' pela TLB; se a página não estiver lá, consulta a tabela
+//   de páginas e coloca a tradução na TLB, no lugar da entrada mais antiga
+//   do conjunto
+// coloca em '*pentrada' a entrada da TLB usada
+static err_t mmu__traduz(mmu_t *self, int endvirt, int *pendfis,
+                         tlb_entrada_t **pentrada)
+{
+  if (endvirt < 0) return ERR_END_INV;
+  int pagina, desloc;
+  mmu__separa(self, endvirt, &pagina, &desloc);
+  int n_conj = mmu__conjunto(pagina, self->asid);
+  tlb_entrada_t *conj = self->tlb[n_conj];
+  for (int via = 0; via < TLB_N_VIAS; via++) {
+    if (conj[via].pagina == pagina && conj[via].asid == self->asid) {
+      self->tlb_acertos++;
+      *pendfis = conj[via].base + desloc;
+      *pentrada = &conj[via];
+      return ERR_OK;
+    }
+  }
+  self->tlb_faltas++;
+  int quadro;
+  int permissoes;
+  err_t err = tabpag_traduz(self->tabpag, pagina, &quadro, &permissoes);
+  if (err != ERR_OK) return err;
+  int base = quadro * self->tam_pagina;
+  int via = self->tlb_vitima[n_conj];
+  self->tlb_vitima[n_conj] = (via + 1) % TLB_N_VIAS;
+  conj[via].pagina = pagina;
+  conj[via].asid = self->asid;
+  conj[via].base = base;
+  conj[via].acessada = false;
+  conj[via].alterada = false;
+  conj[via].permissoes = permissoes;
+  *pendfis = base + desloc;
+  *pentrada = &conj[via];
+  return ERR_OK;
+}
+
+// marca na tabela de páginas o acesso à página da entrada, se ainda não
+//   tiver sido marcado
+static inline void mmu__marca_acesso(mmu_t *self, tlb_entrada_t *entrada,
+                                     bool alteracao)
+{
+  if (!entrada->acessada || (alteracao && !entrada->alterada)) {
+    tabpag_marca_bit_acesso(self->tabpag, entrada->pagina, alteracao);
+    entrada->acessada = true;
+    if (alteracao) entrada->alterada = true;
+  }
 }
 
 err_t mmu_le(mmu_t *self, int endvirt, int *pvalor, cpu_modo_t modo)
@@ -35,12 +254,13 @@ err_t mmu_le(mmu_t *self, int endvirt, int *pvalor, cpu_modo_t modo)
   if (modo == supervisor || self->tabpag == NULL) {
     return mem_le(self->mem, endvirt, pvalor);
   }
+  tlb_entrada_t *entrada;
   int endfis;
-  err_t err = tabpag_traduz(self->tabpag, endvirt, &endfis);
+  err_t err = mmu__traduz(self, endvirt, &endfis, &entrada);
   if (err == ERR_OK) {
     err = mem_le(self->mem, endfis, pvalor);
     if (err == ERR_OK) {
-      tabpag_marca_bit_acesso(self->tabpag, endvirt / TAM_PAGINA, false);
+      mmu__marca_acesso(self, entrada, false);
     }
   }
   return err;
@@ -51,13 +271,105 @@ err_t mmu_escreve(mmu_t *self, int endvirt, int valor, cpu_modo_t modo)
   if (modo == supervisor || self->tabpag == NULL) {
     return mem_escreve(self->mem, endvirt, valor);
   }
+  tlb_entrada_t *entrada;
   int endfis;
-  err_t err = tabpag_traduz(self->tabpag, endvirt, &endfis);
+  err_t err = mmu__traduz(self, endvirt, &endfis, &entrada);
+  // a página está no quadro, mas não pode ser alterada
+  if (err == ERR_OK && !(entrada->permissoes & PERM_ESCRITA)) {
+    err = ERR_PROTECAO;
+  }
   if (err == ERR_OK) {
     err = mem_escreve(self->mem, endfis, valor);
     if (err == ERR_OK) {
-      tabpag_marca_bit_acesso(self->tabpag, endvirt / TAM_PAGINA, true);
+      mmu__marca_acesso(self, entrada, true);
     }
   }
   return err;
 }
+
+err_t mmu_traduz(mmu_t *self, int endvirt, int *pendfis, cpu_modo_t modo)
+{
+  tlb_entrada_t *entrada;
+  int endfis = endvirt;
+  if (modo == usuario && self->tabpag != NULL) {
+    err_t err = mmu__traduz(self, endvirt, &endfis, &entrada);
+    if (err != ERR_OK) return err;
+    if (!(entrada->permissoes & PERM_EXECUCAO)) return ERR_PROTECAO;
+  }
+  // o endereço tem que existir na memória, senão mmu_le daria erro
+  if (endfis < 0 || endfis >= mem_tam(self->mem)) return ERR_END_INV;
+  if (modo == usuario && self->tabpag != NULL) {
+    mmu__marca_acesso(self, entrada, false);
+  }
+  *pendfis = endfis;
+  return ERR_OK;
+}
+
+// copia 'n' valores entre o espaço virtual a partir de 'endvirt' e
+//   'dest' (leitura) ou 'orig' (escrita, se 'dest' for NULL), traduzindo
+//   uma vez por página e copiando o trecho de cada página de uma vez
+// coloca em '*pcopiados' quantos valores foram copiados antes de um erro
+static err_t mmu__copia(mmu_t *self, int endvirt, int n, int *dest,
+                        const int *orig, int *pcopiados)
+{
+  bool escrita = dest == NULL;
+  int copiados = 0;
+  err_t err = ERR_OK;
+  while (copiados < n) {
+    tlb_entrada_t *entrada;
+    int endfis;
+    err = mmu__traduz(self, endvirt + copiados, &endfis, &entrada);
+    if (err == ERR_OK && escrita && !(entrada->permissoes & PERM_ESCRITA)) {
+      err = ERR_PROTECAO;
+    }
+    if (err != ERR_OK) break;
+    // o trecho vai até o fim da página, ou do que falta copiar
+    int n_trecho = entrada->base + self->tam_pagina - endfis;
+    if (n_trecho > n - copiados) n_trecho = n - copiados;
+    if (escrita) {
+      err = mem_copia_para(self->mem, endfis, n_trecho, orig + copiados);
+    } else {
+      err = mem_copia_de(self->mem, endfis, n_trecho, dest + copiados);
+    }
+    if (err != ERR_OK) break;
+    mmu__marca_acesso(self, entrada, escrita);
+    copiados += n_trecho;
+  }
+  if (pcopiados != NULL) *pcopiados = copiados;
+  return err;
+}
+
+err_t mmu_copia_de(mmu_t *self, int endvirt, int n, int dest[n],
+                   cpu_modo_t modo, int *pcopiados)
+{
+  if (modo == supervisor || self->tabpag == NULL) {
+    err_t err = mem_copia_de(self->mem, endvirt, n, dest);
+    if (pcopiados != NULL) *pcopiados = err == ERR_OK ? n : 0;
+    return err;
+  }
+  return mmu__copia(self, endvirt, n, dest, NULL, pcopiados);
+}
+
+err_t mmu_copia_para(mmu_t *self, int endvirt, int n, const int orig[n],
+                     cpu_modo_t modo, int *pcopiados)
+{
+  if (modo == supervisor || self->tabpag == NULL) {
+    err_t err = mem_copia_para(self->mem, endvirt, n, orig);
+    if (pcopiados != NULL) *pcopiados = err == ERR_OK ? n : 0;
+    return err;
+  }
+  return mmu__copia(self, endvirt, n, NULL, orig, pcopiados);
+}
+
+void mmu_define_observador(mmu_t *self, mem_observador_t func, void *arg)
+{
+  mem_define_observador(self->mem, func, arg);
+}
+
+void mmu_estatisticas_tlb(mmu_t *self, long *pacertos, long *pfaltas,
+                          long *pdescartes)
+{
+  *pacertos = self->tlb_acertos;
+  *pfaltas = self->tlb_faltas;
+  *pdescartes = self->tlb_descartes;
+}
@@ -11,15 +11,27 @@
 #include "err.h"
 #include "cpu_modo.h"
 
+// tamanho de página usado se nenhum outro for escolhido, em palavras de
+//   memória (pode ser alterado na compilação, com -DTAM_PAGINA=n)
+#ifndef TAM_PAGINA
+#define TAM_PAGINA 10
+#endif
+
 // tipo opaco que representa a MMU
 typedef struct mmu_t mmu_t;
 
 // cria uma MMU para gerenciar acessos à memória
 // retorna um ponteiro para um descritor, que deverá ser usado em todas
 //   as operações nessa MMU
-// recebe "mem", a memória física que será gerenciada
-// retorna NULL em caso de erro
-mmu_t *mmu_cria(mem_t *mem);
+// recebe "mem", a memória física que será gerenciada, e o tamanho das
+//   páginas (e quadros), em palavras
+// se o tamanho da página for potência de 2, a tradução separa página e
+//   deslocamento com deslocamento de bits e máscara em vez de divisão
+// retorna NULL em caso de erro (inclusive tamanho de página menor que 1)
+mmu_t *mmu_cria(mem_t *mem, int tam_pagina);
+
+// retorna o tamanho das páginas usado pela MMU, em palavras
+int mmu_tam_pagina(mmu_t *self);
 
 // destrói uma MMU
 // nenhuma outra operação pode ser realizada na MMU após esta chamada
@@ -27,13 +39,21 @@ void mmu_destroi(mmu_t *self);
 
 // define a tabela de páginas a usar nas próximas traduções
 // se tabpag for NULL, os acessos serão repassados sem alteração à memória
+// é a operação feita a cada troca de processo; as traduções de cada
+//   tabela ficam na TLB marcadas com um identificador de espaço de
+//   endereçamento, e as da tabela anterior não precisam ser descartadas
+// a MMU passa a ser avisada pela tabela quando a tradução de uma página
+//   muda (ver tabpag_define_observador), para descartar somente essa
+//   entrada da TLB, e quando a tabela é destruída, para descartar todas
+//   as dela
 void mmu_define_tabpag(mmu_t *self, tabpag_t *tabpag);
 
 // coloca na posição apontada por 'pvalor' o valor que está na memória
 //   no endereço físico correspondente ao endereço virtual 'endvirt'
 // marca a página como acessada se o acesso for bem sucedido
 // retorna erro se acesso não for possível, por um erro de tradução
-//   (ver tabpag_traduz) ou de memória (ver mem_le)
+//   (ver tabpag_traduz) ou de memória (ver mem_le); as permissões da
+//   página não são consultadas, toda página mapeada pode ser lida
 // se o acesso for feito em modo supervisor, ou se a mmu não tiver tabela de
 //   página definida, trata endvirt como enderço físico, repassa o acesso
 //   à memória sem tradução
@@ -43,10 +63,53 @@ err_t mmu_le(mmu_t *self, int endvirt, int *pvalor, cpu_modo_t modo);
 //   virtual 'endvirt'
 // marca a página como acessada e alterada se o acesso for bem sucedido
 // retorna erro se acesso não for possível, por um erro de tradução
-//   (ver tabpag_traduz) ou de memória (ver mem_escreve)
+//   (ver tabpag_traduz) ou de memória (ver mem_escreve); a escrita em
+//   página sem PERM_ESCRITA retorna ERR_PROTECAO
+//   (ver tabpag_define_permissoes)
 // se o acesso for feito em modo supervisor, ou se a mmu não tiver tabela de
 //   página definida, trata endvirt como enderço físico, repassa o acesso
 //   à memória sem tradução
 err_t mmu_escreve(mmu_t *self, int endvirt, int valor, cpu_modo_t modo);
 
+// coloca em '*pendfis' o endereço físico correspondente ao endereço virtual
+//   'endvirt', sem acessar a memória
+// marca a página como acessada se a tradução for bem sucedida
+// é a tradução da busca de instrução: retorna os mesmos erros que mmu_le
+//   retornaria para esse endereço, e ERR_PROTECAO se a página não tiver
+//   PERM_EXECUCAO
+// permite a quem usa a MMU manter dados associados a endereços físicos
+//   (como a cache de instruções decodificadas da CPU)
+err_t mmu_traduz(mmu_t *self, int endvirt, int *pendfis, cpu_modo_t modo);
+
+// copia para 'dest' os 'n' valores a partir do endereço virtual 'endvirt'
+// a tradução é feita uma vez por página, e o trecho de cada página é
+//   copiado de uma vez (ver mem_copia_de); as páginas são marcadas como
+//   acessadas
+// retorna erro como mmu_le, para o primeiro endereço que não puder ser
+//   lido; coloca em '*pcopiados' (se não for NULL) quantos valores foram
+//   copiados (todos, se não houve erro), e o endereço do erro é
+//   'endvirt + *pcopiados' (em modo supervisor ou sem tabela de páginas,
+//   o trecho todo é validado antes, e nada é copiado se tiver erro)
+err_t mmu_copia_de(mmu_t *self, int endvirt, int n, int dest[n],
+                   cpu_modo_t modo, int *pcopiados);
+
+// copia os 'n' valores de 'orig' para o endereço virtual 'endvirt' em
+//   diante, como mmu_copia_de, mas escrevendo; as páginas são marcadas
+//   como acessadas e alteradas
+// retorna erro como mmu_escreve, para o primeiro endereço que não puder
+//   ser escrito
+err_t mmu_copia_para(mmu_t *self, int endvirt, int n, const int orig[n],
+                     cpu_modo_t modo, int *pcopiados);
+
+// define a função a ser chamada quando uma posição da memória física for
+//   alterada, pela MMU ou diretamente (ver mem_define_observador)
+void mmu_define_observador(mmu_t *self, mem_observador_t func, void *arg);
+
+// coloca nas posições apontadas o número de traduções atendidas pela TLB
+//   (acertos), o número das que precisaram consultar a tabela de páginas
+//   (faltas) e o número de vezes que as traduções de uma tabela foram
+//   descartadas todas de uma vez (descartes)
+void mmu_estatisticas_tlb(mmu_t *self, long *pacertos, long *pfaltas,
+                          long *pdescartes);
+
 #endif // MMU_H
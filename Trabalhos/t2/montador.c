@@ -7,6 +7,7 @@
 #include <ctype.h>
 
 #include "instrucao.h"
+#include "programa.h"
 // auxiliares
 
 // aborta o programa com uma mensagem de erro
@@ -41,6 +42,7 @@ int mem_min = -1;       // menor endereço preenchido
 int mem_max = -1;       // maior endereço preenchido
 
 char *nome_fonte;   // nome do arquivo fonte a montar
+bool binario;       // gera o programa no formato binário (ver programa.h)
 
 // coloca um valor no final da memória
 void mem_insere(int val)
@@ -62,16 +64,123 @@ void mem_altera(int pos, int val)
   mem[pos] = val;
 }
 
+// faixas zeradas
+
+// tabela com as faixas da memória reservadas com ESPACO, que não são
+//   impressas com os dados, mas em uma linha "[início] zeros tamanho"
+// o SO não precisa carregar essas faixas, só dar memória zerada a elas
+//   quando forem usadas; faixas menores que ZEROS_MIN ficam junto com os
+//   dados: uma linha "zeros" a mais não compensa para poucas posições, e
+//   o montador não conhece o tamanho de página que vai ser usado (ele é
+//   escolhido na execução), então não tem como saber se uma faixa curta
+//   deixaria alguma página sem precisar ser carregada
+
+#define ZEROS_TAM 1000
+#define ZEROS_MIN 10
+struct {
+  int inicio;
+  int tamanho;
+} zeros[ZEROS_TAM];
+int zeros_num;            // número de faixas na tabela
+
+// insere 'tam' zeros no final da memória, registrando a faixa
+void mem_insere_zeros(int tam)
+{
+  int inicio = mem_pos;
+  for (int i = 0; i < tam; i++) {
+    mem_insere(0);
+  }
+  if (tam < ZEROS_MIN) return;
+  // junta com a faixa anterior, se for logo antes
+  if (zeros_num > 0
+      && zeros[zeros_num-1].inicio + zeros[zeros_num-1].tamanho == inicio) {
+    zeros[zeros_num-1].tamanho += tam;
+    return;
+  }
+  if (zeros_num >= ZEROS_TAM) return;  // fica junto com os dados
+  zeros[zeros_num].inicio = inicio;
+  zeros[zeros_num].tamanho = tam;
+  zeros_num++;
+}
+
+// a memória é dividida em segmentos: as faixas zeradas e os dados entre
+//   elas
+// retorna a última posição do segmento que começa em 'inicio', e se ele
+//   é uma faixa zerada; '*pz' é a próxima faixa zerada, e é avançada se
+//   for esse o segmento
+int mem_segmento(int inicio, int *pz, bool *pzerado)
+{
+  *pzerado = *pz < zeros_num && zeros[*pz].inicio == inicio;
+  if (*pzerado) {
+    int fim = inicio + zeros[*pz].tamanho - 1;
+    (*pz)++;
+    return fim;
+  }
+  if (*pz < zeros_num) return zeros[*pz].inicio - 1;
+  return mem_max;
+}
+
 // imprime o conteúdo da memória
+// os dados são impressos 10 por linha, a não ser antes de uma faixa zerada
 void mem_imprime(void)
 {
   printf("MAQ %d %d\n", mem_max - mem_min + 1, mem_min);
-  for (int i = mem_min; i <= mem_max; i+=10) {
-    printf("[%4d] =", i);
-    for (int j = i; j < i+10 && j <= mem_max; j++) {
-      printf(" %d,", mem[j]);
+  int z = 0;  // próxima faixa zerada
+  int i = mem_min;
+  while (i <= mem_max) {
+    bool zerado;
+    int fim_seg = mem_segmento(i, &z, &zerado);
+    if (zerado) {
+      printf("[%4d] zeros %d\n", i, fim_seg - i + 1);
+      i = fim_seg + 1;
+      continue;
     }
-    printf("\n");
+    for (; i <= fim_seg; i += 10) {
+      printf("[%4d] =", i);
+      for (int j = i; j < i+10 && j <= fim_seg; j++) {
+        printf(" %d,", mem[j]);
+      }
+      printf("\n");
+    }
+    i = fim_seg + 1;
+  }
+}
+
+// escreve um inteiro de 32 bits na saída, em little-endian
+void escreve_int32(int val)
+{
+  for (int i = 0; i < 4; i++) {
+    putchar((val >> (8 * i)) & 0xff);
+  }
+}
+
+// escreve o conteúdo da memória no formato binário
+// a descrição dos segmentos vem antes dos valores, então a memória é
+//   percorrida duas vezes: a primeira só para contar os segmentos
+void mem_imprime_binario(void)
+{
+  int n_seg = 0;
+  bool zerado;
+  for (int i = mem_min, z = 0; i <= mem_max; n_seg++) {
+    i = mem_segmento(i, &z, &zerado) + 1;
+  }
+  fwrite(MAQ_MAGICO, 1, 4, stdout);
+  escreve_int32(mem_max - mem_min + 1);
+  escreve_int32(mem_min);
+  escreve_int32(n_seg);
+  for (int i = mem_min, z = 0; i <= mem_max; ) {
+    int fim_seg = mem_segmento(i, &z, &zerado);
+    escreve_int32(i);
+    escreve_int32(fim_seg - i + 1);
+    escreve_int32(zerado ? MAQ_SEG_ZEROS : MAQ_SEG_DADOS);
+    i = fim_seg + 1;
+  }
+  for (int i = mem_min, z = 0; i <= mem_max; ) {
+    int fim_seg = mem_segmento(i, &z, &zerado);
+    for (; !zerado && i <= fim_seg; i++) {
+      escreve_int32(mem[i]);
+    }
+    i = fim_seg + 1;
   }
 }
 
@@ -176,9 +285,7 @@ void monta_instrucao(int linha, int opcode, char *arg)
               linha);
       return;
     }
-    for (int i = 0; i < argn; i++) {
-      mem_insere(0);
-    }
+    mem_insere_zeros(argn);
     return;
   } else if (opcode == VALOR) {
     // nao faz nada, vai inserir o valor definido em arg
@@ -382,12 +489,15 @@ void verifica_args(int argc, char *argv[argc])
         fprintf(stderr, "ERRO: endereço inválido: '%s'\n", argv[argi]);
         exit(1);
       }
+    } else if (strcmp(argv[argi], "-b") == 0) {
+      binario = true;
     } else {
       nome_fonte = argv[argi];
     }
   }
   if (nome_fonte == NULL) {
-    fprintf(stderr, "ERRO: chame como '%s [-e end.inicial] nome_do_arquivo'\n",
+    fprintf(stderr,
+            "ERRO: chame como '%s [-b] [-e end.inicial] nome_do_arquivo'\n",
             argv[0]);
     exit(1);
   }
@@ -397,6 +507,10 @@ int main(int argc, char *argv[argc])
 {
   verifica_args(argc, argv);
   monta_arquivo(nome_fonte);
-  mem_imprime();
+  if (binario) {
+    mem_imprime_binario();
+  } else {
+    mem_imprime();
+  }
   return 0;
 }
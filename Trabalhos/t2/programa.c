@@ -1,28 +1,120 @@
 #include "programa.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// o formato binário guarda os valores como inteiros de 32 bits, que são
+//   usados diretamente no arquivo mapeado
+_Static_assert(sizeof(int) == 4, "int deve ter 32 bits");
+
+// faixa de endereços que só tem zeros
+typedef struct {
+  int inicio;
+  int tamanho;
+} faixa_t;
+
+// trecho do programa com dados: 'tamanho' valores a partir do endereço
+//   'inicio', que estão em 'dados'
+typedef struct {
+  int inicio;
+  int tamanho;
+  int *dados;
+} segmento_t;
 
 struct programa_t {
+  int refs;  // referências: quem chamou prog_cria e a cache
   int carga;
   int tamanho;
+  // os trechos com dados, em ordem de endereço; as posições fora deles
+  //   têm zero
+  segmento_t *segmentos;
+  int n_segmentos;
+  faixa_t *zeradas;
+  int n_zeradas;
+  // onde estão os dados: lidos do arquivo texto, ou no arquivo binário
+  //   mapeado em memória
   int *dados;
+  void *mapa;
+  size_t tam_mapa;
 };
 
+// retorna NULL se o tamanho ou o endereço de carga forem negativos, ou se
+//   o fim do programa não couber em um int (cabeçalho corrompido)
+static programa_t *prog__aloca(int tam, int carga)
+{
+  if (tam < 0 || carga < 0 || carga > INT_MAX - tam) return NULL;
+  programa_t *prog = malloc(sizeof(*prog));
+  if (prog == NULL) return NULL;
+  prog->refs = 1;
+  prog->tamanho = tam;
+  prog->carga = carga;
+  prog->segmentos = NULL;
+  prog->n_segmentos = 0;
+  prog->zeradas = NULL;
+  prog->n_zeradas = 0;
+  prog->dados = NULL;
+  prog->mapa = NULL;
+  prog->tam_mapa = 0;
+  return prog;
+}
+
+// retorna false se a faixa não estiver dentro do programa
+// compara sem somar 'ender' e 'tam', que vêm do arquivo e podem estourar
+//   um int (carga + tamanho não estoura, ver prog__aloca)
+static bool prog__na_faixa(programa_t *self, int ender, int tam)
+{
+  return ender >= self->carga && tam >= 1
+         && tam <= self->carga + self->tamanho - ender;
+}
+
+static bool prog__novo_segmento(programa_t *self, int ender, int tam,
+                                int *dados)
+{
+  segmento_t *segmentos = realloc(self->segmentos,
+                                  (self->n_segmentos + 1) * sizeof(segmento_t));
+  if (segmentos == NULL) return false;
+  self->segmentos = segmentos;
+  self->segmentos[self->n_segmentos].inicio = ender;
+  self->segmentos[self->n_segmentos].tamanho = tam;
+  self->segmentos[self->n_segmentos].dados = dados;
+  self->n_segmentos++;
+  return true;
+}
+
+static bool prog__nova_zerada(programa_t *self, int ender, int tam)
+{
+  faixa_t *zeradas = realloc(self->zeradas,
+                             (self->n_zeradas + 1) * sizeof(faixa_t));
+  if (zeradas == NULL) return false;
+  self->zeradas = zeradas;
+  self->zeradas[self->n_zeradas].inicio = ender;
+  self->zeradas[self->n_zeradas].tamanho = tam;
+  self->n_zeradas++;
+  return true;
+}
+
+
+// formato texto
+
 // lê os dados do cabeçalho do arquivo (1ª linha)
 // tem "MAQ" seguido do tamanho e endereço inicial do programa
+// os dados do programa todo ficam em um segmento só
 static programa_t *pega_cabecalho(char *lin)
 {
   int tam, carga;
   if (sscanf(lin, "MAQ %d %d", &tam, &carga) != 2) return NULL;
-  programa_t *prog = malloc(sizeof(*prog));
+  programa_t *prog = prog__aloca(tam, carga);
   if (prog == NULL) return NULL;
   prog->dados = calloc(sizeof(int), tam);
-  if (prog->dados == NULL) {
-    free(prog);
+  if (prog->dados == NULL
+      || !prog__novo_segmento(prog, carga, tam, prog->dados)) {
+    prog_destroi(prog);
     return NULL;
   }
-  prog->tamanho = tam;
-  prog->carga = carga;
   return prog;
 }
 
@@ -32,8 +124,9 @@ static programa_t *pega_cabecalho(char *lin)
 static void pega_dados(programa_t *self, char *lin)
 {
   int ender;
-  int pos, p;
-  if (sscanf(lin, " [%d] =%n", &ender, &pos) != 1) return;
+  int pos = -1, p;
+  // sem o '=', não é linha de dados (pos não é alterado)
+  if (sscanf(lin, " [%d] =%n", &ender, &pos) != 1 || pos == -1) return;
   ender -= self->carga;
   int dado;
   while (sscanf(lin+pos, "%d ,%n", &dado, &p) == 1) {
@@ -44,10 +137,19 @@ static void pega_dados(programa_t *self, char *lin)
   }
 }
 
-programa_t *prog_cria(char *nome)
+// lê uma faixa zerada
+// a linha tem o endereço inicial entre colchetes, "zeros" e o número de
+//   posições; os dados já estão zerados, só a faixa é guardada
+static void pega_zeros(programa_t *self, char *lin)
+{
+  int ender, tam;
+  if (sscanf(lin, " [%d] zeros %d", &ender, &tam) != 2) return;
+  if (!prog__na_faixa(self, ender, tam)) return;
+  prog__nova_zerada(self, ender, tam);
+}
+
+static programa_t *prog__cria_texto(FILE *arq)
 {
-  FILE *arq = fopen(nome, "r");
-  if (arq == NULL) return NULL;
   char *linha = NULL;
   size_t tam_lin;
   programa_t *prog = NULL;
@@ -56,16 +158,171 @@ programa_t *prog_cria(char *nome)
   if (prog == NULL) goto fim;
   while (getline(&linha, &tam_lin, arq) != -1) {
     pega_dados(prog, linha);
+    pega_zeros(prog, linha);
   }
 fim:
   free(linha);
+  return prog;
+}
+
+
+// formato binário
+
+// inteiro de 32 bits little-endian a partir de 'p'
+static int le32(unsigned char *p)
+{
+  return (int)((unsigned)p[0] | (unsigned)p[1] << 8 | (unsigned)p[2] << 16
+               | (unsigned)p[3] << 24);
+}
+
+// mapeia o arquivo em memória, e os segmentos de dados passam a apontar
+//   para os valores no mapeamento, sem cópia
+// o mapeamento é privado: se a máquina não for little-endian, os valores
+//   são convertidos nele, sem alterar o arquivo
+static programa_t *prog__cria_binario(FILE *arq)
+{
+  struct stat st;
+  if (fstat(fileno(arq), &st) != 0 || st.st_size < MAQ_TAM_CAB) return NULL;
+  size_t tam_mapa = st.st_size;
+  unsigned char *mapa = mmap(NULL, tam_mapa, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE, fileno(arq), 0);
+  if (mapa == MAP_FAILED) return NULL;
+  programa_t *prog = prog__aloca(le32(mapa + 4), le32(mapa + 8));
+  if (prog == NULL) {
+    munmap(mapa, tam_mapa);
+    return NULL;
+  }
+  prog->mapa = mapa;
+  prog->tam_mapa = tam_mapa;
+  int n_seg = le32(mapa + 12);
+  size_t pos = MAQ_TAM_CAB + (size_t)n_seg * MAQ_TAM_SEG;
+  if (n_seg < 0 || pos > tam_mapa) goto erro;
+  for (int i = 0; i < n_seg; i++) {
+    unsigned char *seg = mapa + MAQ_TAM_CAB + i * MAQ_TAM_SEG;
+    int inicio = le32(seg);
+    int tam = le32(seg + 4);
+    if (!prog__na_faixa(prog, inicio, tam)) goto erro;
+    if (le32(seg + 8) == MAQ_SEG_ZEROS) {
+      if (!prog__nova_zerada(prog, inicio, tam)) goto erro;
+      continue;
+    }
+    if (pos + (size_t)tam * 4 > tam_mapa) goto erro;
+    int *dados = (int *)(mapa + pos);
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    for (int j = 0; j < tam; j++) {
+      dados[j] = le32(mapa + pos + j * 4);
+    }
+#endif
+    if (!prog__novo_segmento(prog, inicio, tam, dados)) goto erro;
+    pos += (size_t)tam * 4;
+  }
+  return prog;
+erro:
+  prog_destroi(prog);
+  return NULL;
+}
+
+static programa_t *prog__le_arquivo(char *nome)
+{
+  FILE *arq = fopen(nome, "r");
+  if (arq == NULL) return NULL;
+  char magico[4];
+  programa_t *prog;
+  if (fread(magico, 1, 4, arq) == 4 && memcmp(magico, MAQ_MAGICO, 4) == 0) {
+    prog = prog__cria_binario(arq);
+  } else {
+    rewind(arq);
+    prog = prog__cria_texto(arq);
+  }
   fclose(arq);
   return prog;
 }
 
+
+// cache de programas
+
+// os últimos programas lidos, com o nome, a data de alteração e o tamanho
+//   do arquivo de onde vieram; cada um tem uma referência da cache
+// quando não tem entrada livre, a substituída é a usada há mais tempo
+#define PROG_CACHE_TAM 16
+static struct {
+  char *nome;  // NULL se a entrada está livre
+  struct timespec mtime;
+  off_t tamanho;
+  long uso;    // quando a entrada foi usada pela última vez
+  programa_t *prog;
+} cache[PROG_CACHE_TAM];
+static long cache_relogio;
+static long cache_acertos;
+static long cache_faltas;
+
+static void prog__libera_entrada(int i)
+{
+  free(cache[i].nome);
+  cache[i].nome = NULL;
+  prog_destroi(cache[i].prog);
+}
+
+programa_t *prog_cria(char *nome)
+{
+  struct stat st;
+  if (stat(nome, &st) != 0) return NULL;
+  int livre = 0;
+  for (int i = 0; i < PROG_CACHE_TAM; i++) {
+    if (cache[i].nome == NULL) {
+      livre = i;
+      break;
+    }
+    if (strcmp(cache[i].nome, nome) == 0) {
+      if (cache[i].tamanho == st.st_size
+          && cache[i].mtime.tv_sec == st.st_mtim.tv_sec
+          && cache[i].mtime.tv_nsec == st.st_mtim.tv_nsec) {
+        cache_acertos++;
+        cache[i].uso = ++cache_relogio;
+        cache[i].prog->refs++;
+        return cache[i].prog;
+      }
+      // o arquivo mudou: a entrada é reaproveitada para a nova versão
+      livre = i;
+      break;
+    }
+    if (cache[i].uso < cache[livre].uso) livre = i;
+  }
+  cache_faltas++;
+  programa_t *prog = prog__le_arquivo(nome);
+  if (prog == NULL) return NULL;
+  char *copia = strdup(nome);
+  if (copia == NULL) return prog;  // fica fora da cache
+  if (cache[livre].nome != NULL) prog__libera_entrada(livre);
+  cache[livre].nome = copia;
+  cache[livre].mtime = st.st_mtim;
+  cache[livre].tamanho = st.st_size;
+  cache[livre].uso = ++cache_relogio;
+  cache[livre].prog = prog;
+  prog->refs++;
+  return prog;
+}
+
+void prog_estatisticas_cache(long *pacertos, long *pfaltas)
+{
+  *pacertos = cache_acertos;
+  *pfaltas = cache_faltas;
+}
+
+void prog_esvazia_cache(void)
+{
+  for (int i = 0; i < PROG_CACHE_TAM; i++) {
+    if (cache[i].nome != NULL) prog__libera_entrada(i);
+  }
+}
+
 void prog_destroi(programa_t *self)
 {
+  if (--self->refs > 0) return;
+  if (self->mapa != NULL) munmap(self->mapa, self->tam_mapa);
   free(self->dados);
+  free(self->segmentos);
+  free(self->zeradas);
   free(self);
 }
 
@@ -87,5 +344,31 @@ int prog_end_inicio(programa_t *self)
 int prog_dado(programa_t *self, int ender)
 {
   if (ender < self->carga || ender >= self->carga + self->tamanho) return -1;
-  return self->dados[ender - self->carga];
+  int *dados;
+  if (prog_dados(self, ender, &dados) == 0) return 0;
+  return *dados;
+}
+
+int prog_dados(programa_t *self, int ender, int **pdados)
+{
+  for (int i = 0; i < self->n_segmentos; i++) {
+    segmento_t *seg = &self->segmentos[i];
+    if (ender >= seg->inicio && ender - seg->inicio < seg->tamanho) {
+      *pdados = seg->dados + (ender - seg->inicio);
+      return seg->tamanho - (ender - seg->inicio);
+    }
+  }
+  return 0;
+}
+
+int prog_n_faixas_zeradas(programa_t *self)
+{
+  return self->n_zeradas;
+}
+
+void prog_faixa_zerada(programa_t *self, int faixa, int *pinicio,
+                       int *ptamanho)
+{
+  *pinicio = self->zeradas[faixa].inicio;
+  *ptamanho = self->zeradas[faixa].tamanho;
 }
@@ -2,17 +2,52 @@
 #define PROGRAMA_H
 
 // TAD para representar um programa lido de um arquivo '.maq'
+//
+// o arquivo pode estar em dois formatos, gerados pelo montador:
+// - texto: a primeira linha tem "MAQ tamanho carga", e cada uma das
+//   seguintes tem "[endereço] = valor, valor, ...," ou, para uma faixa que
+//   só tem zeros, "[endereço] zeros tamanho"
+// - binário (montador -b): começa com MAQ_MAGICO, seguido de inteiros de
+//   32 bits little-endian: tamanho, carga e número de segmentos; depois,
+//   para cada segmento, endereço inicial, tamanho e tipo (MAQ_SEG_DADOS
+//   ou MAQ_SEG_ZEROS); depois os valores dos segmentos de dados, na ordem
+//   dos segmentos; o arquivo é mapeado em memória (mmap), e os valores são
+//   usados de lá, sem ser interpretados nem copiados
+// as posições do programa que não estão em nenhum segmento de dados têm
+//   zero
+
+#define MAQ_MAGICO    "MAQB"
+#define MAQ_TAM_CAB   16  // bytes do cabeçalho (mágico e 3 inteiros)
+#define MAQ_TAM_SEG   12  // bytes da descrição de cada segmento
+#define MAQ_SEG_DADOS 0
+#define MAQ_SEG_ZEROS 1
 
 typedef struct programa_t programa_t;
 
-// cria e inicializa um programa com o conteúdo do arquivo 'nome'
+// cria e inicializa um programa com o conteúdo do arquivo 'nome', em
+//   qualquer dos formatos
+// os programas lidos ficam em uma cache: se o arquivo não mudou desde a
+//   última leitura (mesma data de alteração e mesmo tamanho), retorna o
+//   mesmo programa (o mesmo ponteiro), sem abrir nem interpretar o
+//   arquivo; se o arquivo mudou, o programa retornado é outro
 // retorna NULL em caso de erro
 programa_t *prog_cria(char *nome);
 
 // destrói um programa
+// cada chamada a prog_cria deve ter uma a prog_destroi; o programa só é
+//   liberado quando não é mais usado por ninguém (nem pela cache)
 // nenhuma outra operação pode ser realizada no programa após esta chamada
 void prog_destroi(programa_t *self);
 
+// coloca nas posições apontadas o número de chamadas a prog_cria que
+//   foram atendidas pela cache (acertos) e o das que leram o arquivo
+//   (faltas)
+void prog_estatisticas_cache(long *pacertos, long *pfaltas);
+
+// tira todos os programas da cache (os que ainda estão sendo usados só
+//   são liberados no prog_destroi de quem usa)
+void prog_esvazia_cache(void);
+
 // número de posições de memória necessárias para executar o programa
 int prog_tamanho(programa_t *self);
 
@@ -26,4 +61,24 @@ int prog_end_inicio(programa_t *self);
 // valor a colocar na posição 'ender' da memória
 int prog_dado(programa_t *self, int ender);
 
+// coloca em '*pdados' um ponteiro para o valor da posição 'ender' da
+//   memória, e retorna quantos valores seguidos a partir dele podem ser
+//   lidos pelo ponteiro (até o fim do segmento de dados)
+// retorna 0 (e não altera '*pdados') se a posição não está em um segmento
+//   de dados (o valor dela é zero, ou ela não é do programa)
+// permite copiar o programa em trechos, em vez de valor por valor
+int prog_dados(programa_t *self, int ender, int **pdados);
+
+// número de faixas de endereços do programa que só têm zeros (reservadas
+//   com ESPACO), marcadas no arquivo com uma linha "[início] zeros tamanho"
+// os dados dessas faixas também estão disponíveis em prog_dado, mas quem
+//   carrega o programa pode preferir não copiá-los
+int prog_n_faixas_zeradas(programa_t *self);
+
+// coloca em '*pinicio' o endereço inicial e em '*ptamanho' o número de
+//   posições da faixa zerada 'faixa', entre 0 e prog_n_faixas_zeradas - 1,
+//   em ordem crescente de endereço
+void prog_faixa_zerada(programa_t *self, int faixa, int *pinicio,
+                       int *ptamanho);
+
 #endif // PROGRAMA_H
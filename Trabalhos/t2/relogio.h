@@ -20,6 +20,11 @@ void rel_destroi(relogio_t *self);
 // esta função é chamada pelo controlador após a execução de cada instrução
 void rel_tictac(relogio_t *self);
 
+// registra a passagem de 'n' unidades de tempo, como se rel_tictac fosse
+//   chamada 'n' vezes
+// esta função é chamada pelo controlador após a execução de várias instruções
+void rel_avanca(relogio_t *self, int n);
+
 // retorna a hora atual do sistema, em unidades de tempo
 int rel_agora(relogio_t *self);
 
@@ -3,23 +3,154 @@
 #include "programa.h"
 #include "instrucao.h"
 #include "tabpag.h"
+#include "subst.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
 // intervalo entre interrupções do relógio
 #define INTERVALO_INTERRUPCAO 50   // em instruções executadas
 
-// Não tem processos nem memória virtual, mas é preciso usar a paginação,
-//   pelo menos para implementar relocação, já que os programas estão sendo
-//   todos montados para serem executados no endereço 0 e o endereço 0
-//   físico é usado pelo hardware nas interrupções.
-// Os programas vão ser carregados no início de um quadro, e usar quantos
-//   quadros forem necessárias. Para isso a variável quadro_livre vai conter
-//   o número do primeiro quadro da memória principal que ainda não foi usado.
-//   Na carga do processo, a tabela de páginas (deveria ter uma por processo,
-//   mas não tem processo) é alterada para que o endereço virtual 0 resulte
-//   no quadro onde o programa foi carregado.
+// algoritmo padrão de substituição de páginas
+#define SUBST SUBST_WSCLOCK
+// tamanho padrão do conjunto de trabalho para o WSClock
+#define TAU 4                      // em interrupções de relógio
+// número máximo de páginas percebidas em uso a cada interrupção do relógio
+#define MAX_PAGINAS_COLETA 64
+
+// número máximo de processos existindo ao mesmo tempo
+// não pode ser maior que o número de bits de um unsigned (ver quadro_t)
+#define MAX_PROCESSOS 16
+// tempo que um processo pode executar antes de ceder a CPU para outro
+#define QUANTUM 5                  // em interrupções de relógio
+// número de terminais; o processo com pid n usa o terminal (n-1) % N_TERM
+#define N_TERM 4
+// número máximo de programas diferentes com imagem guardada no disco
+#define MAX_IMAGENS 16
+
+// Cada processo tem um espaço de endereçamento próprio, implementado por
+//   paginação: todos os programas estão sendo montados para serem
+//   executados no endereço 0, e cada página de um processo vai ser colocada
+//   em um quadro qualquer da memória principal. A tabela de páginas do
+//   processo (uma por processo, no seu descritor) é alterada para que o
+//   endereço virtual da página resulte nesse quadro. A tabela de quadros
+//   diz qual página de qual processo está em cada quadro.
+// A troca de processo só precisa entregar a tabela do novo processo para
+//   a MMU (em so_despacha); as traduções de cada tabela ficam na TLB
+//   marcadas com o espaço de endereçamento a que pertencem.
+// Os programas são carregados no disco (memória secundária), e as páginas
+//   são colocadas na memória principal por demanda: todas começam ausentes
+//   na tabela de páginas, e o acesso a uma delas causa um erro na CPU,
+//   tratado em so_trata_irq_err_cpu.
+// As transferências entre a memória principal e o disco são assíncronas:
+//   o SO mantém uma fila de pedidos, passa um de cada vez para o disco, e
+//   o disco gera uma interrupção (IRQ_DISCO) quando termina. Enquanto a
+//   página que causou a falta não chega, o processo fica bloqueado, e o
+//   quadro que vai recebê-la fica reservado; outro processo que tiver falta
+//   no mesmo bloco enquanto isso espera a mesma leitura, e compartilha o
+//   quadro.
+// Um processo criado com SO_FORK compartilha com o pai os quadros e os
+//   blocos do disco das páginas do programa; as páginas compartilhadas que
+//   estão na memória ficam sem permissão de escrita nas duas tabelas de
+//   páginas, e a primeira escrita de um deles em uma delas causa uma
+//   violação de proteção (ERR_PROTECAO), que é tratada copiando a página
+//   para um quadro só desse processo. Um bloco do disco compartilhado não
+//   é alterado: a gravação de uma página que está nele é feita em outro
+//   bloco.
+// Da mesma forma, a primeira carga de um programa deixa no disco a imagem
+//   dele, que é usada pelos processos criados depois para o mesmo programa
+//   (ver imagem_t): eles passam a usar os blocos da imagem, e os quadros
+//   onde estão páginas dela ainda não alteradas.
+// As páginas do programa que só têm zeros (reservadas com ESPACO, ver
+//   prog_faixa_zerada) não vão para o disco: ficam sem bloco até serem
+//   gravadas, e a falta de uma delas é tratada zerando um quadro.
+// Quando não tem quadro livre, um quadro é escolhido pelo algoritmo de
+//   substituição (ver subst.h); se a página que está nele foi alterada, é
+//   gravada no disco antes da leitura da nova página (as não alteradas não
+//   precisam ser gravadas). O tempo virtual de um processo conta as
+//   interrupções de relógio em que ele estava executando; a cada uma, as
+//   páginas com bit de acesso ligado têm o bit zerado e o algoritmo é
+//   avisado do acesso.
+
+// estado de um processo
+typedef enum {
+  PRONTO,      // pode executar (inclusive o que está executando)
+  BLOQUEADO,   // esperando alguma coisa, ver espera_t
+} estado_proc_t;
+
+// o que um processo bloqueado está esperando
+typedef enum {
+  ESPERA_PAGINA,    // a leitura de uma página do disco
+  ESPERA_PROC,      // a morte de outro processo
+  ESPERA_GRAVACAO,  // o fim da gravação de um quadro no disco
+} espera_t;
+
+// descritor de processo
+typedef struct {
+  int pid;                 // 0 se a entrada da tabela de processos está livre
+  estado_proc_t estado;
+  espera_t espera;         // motivo do bloqueio
+  int pid_esperado;        // se espera a morte de um processo, qual
+  int quadro_esperado;     // se espera uma gravação, de que quadro
+  // estado da CPU, salvo quando o processo não está executando
+  int PC, A, X, erro, complemento;
+  int terminal;            // terminal de entrada e saída (0 é o A)
+  // espaço de endereçamento: a tabela de páginas, as páginas do programa
+  //   e o bloco do disco onde está cada uma delas (blocos[0] é o da
+  //   pagina_ini; -1 se a página ainda não tem bloco, e é zerada quando
+  //   vai para a memória)
+  tabpag_t *tabpag;
+  int pagina_ini;
+  int pagina_fim;
+  int *blocos;
+  // tempo virtual do processo
+  int t_virtual;
+} processo_t;
+
+// imagem de um programa no disco, como foi lida do arquivo, com as
+//   páginas em blocos seguidos, menos as que só têm zeros, que ficam
+//   sem bloco
+// enquanto está na tabela de imagens, cada bloco tem uma referência da
+//   imagem, e por isso nunca é alterado
+// a imagem guarda o programa de onde foi feita, para saber se o arquivo
+//   mudou depois: nesse caso, prog_cria retorna outro programa
+typedef struct {
+  char nome[100];
+  programa_t *prog;
+  int end_ini;     // endereços virtuais da primeira e última posição
+  int end_fim;
+  int *blocos;     // bloco de cada página, -1 se a página só tem zeros
+} imagem_t;
+
+// descritor de quadro da memória principal
+// uma página pode estar mapeada no quadro por mais de um processo (todos
+//   com o mesmo número de página e o mesmo bloco do disco)
+typedef struct {
+  unsigned donos;  // processos donos da página, um bit por posição na
+                   //   tabela de processos
+  int pagina;      // página que está no quadro, -1 se o quadro está livre
+  bool reservado;  // o quadro está esperando uma página ser lida do disco
+  int gravando;    // número de gravações do quadro na fila do disco
+  bool alterada;   // a página foi alterada por um dono que deixou de ser
+} quadro_t;
+
+// pedido de transferência entre um quadro e o disco
+typedef struct pedido_t pedido_t;
+struct pedido_t {
+  int comando;     // DISCO_LE ou DISCO_GRAVA
+  int quadro;      // índice na tabela de quadros
+  int end_disco;
+  // na leitura, a página a mapear no quadro quando terminar, o processo
+  //   que espera por ela (NULL se ele morreu antes), e os outros processos
+  //   que tiveram falta na mesma página do mesmo bloco enquanto ela estava
+  //   sendo lida (um bit por posição na tabela de processos, como em
+  //   quadro_t), que vão compartilhar o quadro
+  int pagina;
+  processo_t *dono;
+  unsigned outros;
+  pedido_t *prox;
+};
 
 struct so_t {
   cpu_t *cpu;
@@ -27,12 +158,51 @@ struct so_t {
   mmu_t *mmu;
   console_t *console;
   relogio_t *relogio;
-  // quando tiver memória virtual, o controle de memória livre e ocupada
-  //   é mais completo que isso
-  int quadro_livre;
-  // quando tiver processos, não tem essa tabela aqui, tem que tem uma para
-  //   cada processo
-  tabpag_t *tabpag;
+  // tabela de processos, o processo em execução (NULL se nenhum), a
+  //   posição na tabela do último escolhido para executar, e quanto tempo
+  //   ele ainda pode executar
+  processo_t processos[MAX_PROCESSOS];
+  processo_t *corrente;
+  int ultimo_escolhido;
+  int quantum;
+  int prox_pid;
+  // tabela de quadros da memória principal, a partir de primeiro_quadro
+  //   (os anteriores não são usados por programas de usuário)
+  // os quadros a partir de n_quadros_usados nunca foram usados, estão
+  //   livres e nem têm o descritor inicializado; os quadros são ocupados
+  //   em ordem, então uma memória grande que nunca é toda usada não custa
+  //   nada além do que é usado (nem aqui nem na memória simulada)
+  quadro_t *quadros;
+  int primeiro_quadro;
+  int n_quadros;
+  int n_quadros_usados;
+  // algoritmo de substituição de páginas, e tamanho do conjunto de
+  //   trabalho (para os que usam)
+  subst_t *subst;
+  int tau;
+  // tamanho das páginas e quadros, o mesmo que o da MMU
+  int tam_pagina;
+  // memória secundária, dividida em blocos do tamanho de uma página, com
+  //   o número de páginas de processos em cada bloco, e a fila de pedidos
+  //   de transferência (o primeiro é o que está sendo feito pelo disco)
+  // os blocos cujo número de referências chega a zero vão para a pilha de
+  //   blocos livres, e são reusados antes dos que nunca foram usados (a
+  //   partir de bloco_livre) (ver so_aloca_bloco)
+  disco_t *disco;
+  int n_blocos;
+  int bloco_livre;
+  int *disco_refs;
+  int *blocos_livres;
+  int n_blocos_livres;
+  // imagens dos programas já carregados
+  imagem_t imagens[MAX_IMAGENS];
+  int n_imagens;
+  pedido_t *pedidos;
+  pedido_t *ultimo_pedido;
+  int n_faltas_pag;
+  int n_gravacoes;
+  int n_copias;
+  int n_zeradas;
 };
 
 
@@ -40,14 +210,35 @@ struct so_t {
 static err_t so_trata_interrupcao(void *argC, int reg_A);
 
 // funções auxiliares
-static int so_carrega_programa(so_t *self, char *nome_do_executavel);
+static processo_t *so_cria_processo(so_t *self, char *nome_do_executavel);
+static processo_t *so_clona_processo(so_t *self, processo_t *pai);
+static void so_mata_processo(so_t *self, processo_t *proc);
+static processo_t *so_busca_processo(so_t *self, int pid);
+static int so_carrega_programa(so_t *self, processo_t *proc,
+                               char *nome_do_executavel);
+static bool so_trata_falta_de_pagina(so_t *self, processo_t *proc,
+                                     int end_virt);
+static bool so_trata_violacao(so_t *self, processo_t *proc, int end_virt);
+static void so_inicia_transferencia(so_t *self);
+static void so_termina_transferencia(so_t *self);
+static void so_libera_quadros(so_t *self, processo_t *proc);
+static int *so_bloco(processo_t *proc, int pagina);
+static int so_aloca_bloco(so_t *self);
+static void so_solta_bloco(so_t *self, int bloco, int n_refs);
+static unsigned so_bit_do_processo(so_t *self, processo_t *proc);
+static processo_t *so_proximo_dono(so_t *self, quadro_t *q, int *pi);
+static bool so_quadro_alterado(so_t *self, int quadro);
+static void so_compartilha_quadro(so_t *self, int quadro, processo_t *proc);
+static void so_atualiza_acessos(so_t *self);
+static const subst_ops_t so_subst_ops;
 static bool so_copia_str_do_processo(so_t *self, int tam, char str[tam],
-                                     int end_virt/*, processo*/);
+                                     int end_virt, processo_t *proc,
+                                     bool *pfalta);
 
 
 
 so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu,
-              console_t *console, relogio_t *relogio)
+              console_t *console, relogio_t *relogio, disco_t *disco)
 {
   so_t *self = malloc(sizeof(*self));
   if (self == NULL) return NULL;
@@ -57,6 +248,7 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu,
   self->mmu = mmu;
   self->console = console;
   self->relogio = relogio;
+  self->disco = disco;
 
   // quando a CPU executar uma instrução CHAMAC, deve chamar a função
   //   so_trata_interrupcao
@@ -76,23 +268,121 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu,
   // programa o relógio para gerar uma interrupção após INTERVALO_INTERRUPCAO
   rel_escr(self->relogio, 2, INTERVALO_INTERRUPCAO);
 
-  // inicializa a tabela de páginas global, e entrega ela para a MMU
-  // com processos, essa tabela não existiria, teria uma por processo
-  self->tabpag = tabpag_cria();
-  mmu_define_tabpag(self->mmu, self->tabpag);
+  // a tabela de processos começa vazia; o primeiro processo é criado na
+  //   interrupção de reset
+  for (int i = 0; i < MAX_PROCESSOS; i++) {
+    self->processos[i].pid = 0;
+  }
+  self->corrente = NULL;
+  self->ultimo_escolhido = MAX_PROCESSOS - 1;
+  self->quantum = 0;
+  self->prox_pid = 1;
+
   // define o primeiro quadro livre de memória como o seguinte àquele que
   //   contém o endereço 99 (as 100 primeiras posições de memória (pelo menos)
   //   não vão ser usadas por programas de usuário)
-  self->quadro_livre = 99 / TAM_PAGINA + 1;
+  self->tam_pagina = mmu_tam_pagina(self->mmu);
+  self->primeiro_quadro = 99 / self->tam_pagina + 1;
+  self->n_quadros = mem_tam(self->mem) / self->tam_pagina
+                    - self->primeiro_quadro;
+  if (self->n_quadros < 1) {
+    free(self);
+    return NULL;
+  }
+  self->quadros = malloc(self->n_quadros * sizeof(quadro_t));
+  if (self->quadros == NULL) {
+    free(self);
+    return NULL;
+  }
+  self->n_quadros_usados = 0;
+  self->tau = TAU;
+  self->subst = subst_cria(SUBST, self->n_quadros, &so_subst_ops, self);
+  if (self->subst == NULL) {
+    free(self->quadros);
+    free(self);
+    return NULL;
+  }
+  subst_define_tau(self->subst, self->tau);
+
+  self->n_blocos = mem_tam(disco_conteudo(self->disco)) / self->tam_pagina;
+  self->disco_refs = calloc(self->n_blocos, sizeof(int));
+  self->blocos_livres = malloc(self->n_blocos * sizeof(int));
+  if (self->disco_refs == NULL || self->blocos_livres == NULL) {
+    free(self->disco_refs);
+    free(self->blocos_livres);
+    subst_destroi(self->subst);
+    free(self->quadros);
+    free(self);
+    return NULL;
+  }
+  self->bloco_livre = 0;
+  self->n_blocos_livres = 0;
+  self->n_imagens = 0;
+  self->pedidos = NULL;
+  self->ultimo_pedido = NULL;
+  self->n_faltas_pag = 0;
+  self->n_gravacoes = 0;
+  self->n_copias = 0;
+  self->n_zeradas = 0;
   return self;
 }
 
 void so_destroi(so_t *self)
 {
   cpu_define_chamaC(self->cpu, NULL, NULL);
+  while (self->pedidos != NULL) {
+    pedido_t *pedido = self->pedidos;
+    self->pedidos = pedido->prox;
+    free(pedido);
+  }
+  for (int i = 0; i < MAX_PROCESSOS; i++) {
+    if (self->processos[i].pid != 0) {
+      tabpag_destroi(self->processos[i].tabpag);
+      free(self->processos[i].blocos);
+    }
+  }
+  for (int i = 0; i < self->n_imagens; i++) {
+    free(self->imagens[i].blocos);
+    prog_destroi(self->imagens[i].prog);
+  }
+  subst_destroi(self->subst);
+  free(self->disco_refs);
+  free(self->blocos_livres);
+  free(self->quadros);
   free(self);
 }
 
+void so_define_tau(so_t *self, int tau)
+{
+  self->tau = tau;
+  subst_define_tau(self->subst, tau);
+}
+
+bool so_define_subst(so_t *self, subst_alg_t alg)
+{
+  subst_t *subst = subst_cria(alg, self->n_quadros, &so_subst_ops, self);
+  if (subst == NULL) return false;
+  subst_define_tau(subst, self->tau);
+  // o novo algoritmo fica sabendo dos quadros já ocupados
+  for (int quadro = 0; quadro < self->n_quadros_usados; quadro++) {
+    if (self->quadros[quadro].pagina != -1) {
+      subst_carregou(subst, quadro);
+    }
+  }
+  subst_destroi(self->subst);
+  self->subst = subst;
+  return true;
+}
+
+void so_imprime_estatisticas(so_t *self)
+{
+  console_printf(self->console,
+      "SO: substituição %s: %d faltas de página, %d gravações no disco, "
+      "%d cópias na escrita, %d páginas zeradas",
+      subst_nome(subst_alg(self->subst)), self->n_faltas_pag,
+      self->n_gravacoes, self->n_copias, self->n_zeradas);
+}
+
 
 // Tratamento de interrupção
 
@@ -101,6 +391,7 @@ static err_t so_trata_irq(so_t *self, int irq);
 static err_t so_trata_irq_reset(so_t *self);
 static err_t so_trata_irq_err_cpu(so_t *self);
 static err_t so_trata_irq_relogio(so_t *self);
+static err_t so_trata_irq_disco(so_t *self);
 static err_t so_trata_irq_desconhecida(so_t *self, int irq);
 static err_t so_trata_chamada_sistema(so_t *self);
 
@@ -141,9 +432,14 @@ static void so_salva_estado_da_cpu(so_t *self)
   // se não houver processo corrente, não faz nada
   // salva os registradores que compõem o estado da cpu no descritor do
   //   processo corrente
-  // mem_le(self->mem, IRQ_END_A, endereco onde vai o A no descritor);
-  // mem_le(self->mem, IRQ_END_X, endereco onde vai o X no descritor);
-  // etc
+  processo_t *proc = self->corrente;
+  if (proc == NULL) return;
+  const int *estado = mem_trecho(self->mem, IRQ_END_PC, IRQ_N_END);
+  proc->PC = estado[IRQ_END_PC];
+  proc->A = estado[IRQ_END_A];
+  proc->X = estado[IRQ_END_X];
+  proc->erro = estado[IRQ_END_erro];
+  proc->complemento = estado[IRQ_END_complemento];
 }
 static void so_trata_pendencias(so_t *self)
 {
@@ -152,17 +448,49 @@ static void so_trata_pendencias(so_t *self)
   // - E/S pendente
   // - desbloqueio de processos
   // - contabilidades
+  // por enquanto, os desbloqueios são feitos junto com o que os causa (o
+  //   fim da leitura de uma página, a morte de um processo)
 }
 static void so_escalona(so_t *self)
 {
   // escolhe o próximo processo a executar, que passa a ser o processo
   //   corrente; pode continuar sendo o mesmo de antes ou não
+  // o corrente continua enquanto estiver pronto e tiver quantum; senão,
+  //   escolhe o próximo pronto na tabela, em ordem circular
+  processo_t *proc = self->corrente;
+  if (proc != NULL && proc->estado == PRONTO && self->quantum > 0) return;
+  self->corrente = NULL;
+  for (int i = 1; i <= MAX_PROCESSOS; i++) {
+    int indice = (self->ultimo_escolhido + i) % MAX_PROCESSOS;
+    proc = &self->processos[indice];
+    if (proc->pid != 0 && proc->estado == PRONTO) {
+      self->corrente = proc;
+      self->ultimo_escolhido = indice;
+      self->quantum = QUANTUM;
+      return;
+    }
+  }
 }
 static void so_despacha(so_t *self)
 {
   // se não houver processo corrente, coloca ERR_CPU_PARADA em IRQ_END_erro
   // se houver processo corrente, coloca todo o estado desse processo em
-  //   IRQ_END_*
+  //   IRQ_END_*, e passa a MMU para o espaço de endereçamento dele
+  processo_t *proc = self->corrente;
+  if (proc == NULL) {
+    mem_escreve(self->mem, IRQ_END_erro, ERR_CPU_PARADA);
+    return;
+  }
+  int estado[IRQ_N_END] = {
+    [IRQ_END_PC]          = proc->PC,
+    [IRQ_END_A]           = proc->A,
+    [IRQ_END_X]           = proc->X,
+    [IRQ_END_erro]        = proc->erro,
+    [IRQ_END_complemento] = proc->complemento,
+    [IRQ_END_modo]        = usuario,
+  };
+  mem_copia_para(self->mem, IRQ_END_PC, IRQ_N_END, estado);
+  mmu_define_tabpag(self->mmu, proc->tabpag);
 }
 
 static err_t so_trata_irq(so_t *self, int irq)
@@ -181,6 +509,9 @@ static err_t so_trata_irq(so_t *self, int irq)
     case IRQ_RELOGIO:
       err = so_trata_irq_relogio(self);
       break;
+    case IRQ_DISCO:
+      err = so_trata_irq_disco(self);
+      break;
     default:
       err = so_trata_irq_desconhecida(self, irq);
   }
@@ -189,44 +520,45 @@ static err_t so_trata_irq(so_t *self, int irq)
 
 static err_t so_trata_irq_reset(so_t *self)
 {
-  // coloca o programa "init" na memória
-  // vai programar a tabela de páginas para traduzir os endereços virtuais
-  //   a partir de 0 para o endereço onde ele foi carregado.
-  int ender = so_carrega_programa(self, "init.maq");
-  if (ender < 0) {
+  // cria o processo para o programa "init", com os registradores zerados,
+  //   exceto o PC (o endereço de carga, deve ser o endereço virtual 0);
+  //   o estado dele vai para a CPU em so_despacha
+  if (so_cria_processo(self, "init.maq") == NULL) {
     console_printf(self->console, "SO: problema na carga do programa inicial");
     return ERR_CPU_PARADA;
   }
-
-  // deveria criar um processo para o init, e inicializar o estado do
-  //   processador para esse processo com os registradores zerados, exceto
-  //   o PC e o modo.
-  // como não tem suporte a processos, está carregando os valores dos
-  //   registradores diretamente para a memória, de onde a CPU vai carregar
-  //   para os seus registradores quando executar a instrução RETI
-
-  // altera o PC para o endereço de carga (deve ter sido o endereço virtual 0)
-  mem_escreve(self->mem, IRQ_END_PC, ender);
-  // passa o processador para modo usuário
-  mem_escreve(self->mem, IRQ_END_modo, usuario);
   return ERR_OK;
 }
 
 static err_t so_trata_irq_err_cpu(so_t *self)
 {
   // Ocorreu um erro interno na CPU
-  // O erro está codificado em IRQ_END_erro
+  // O erro está no registrador erro do descritor do processo corrente
   // Em geral, causa a morte do processo que causou o erro
-  // Ainda não temos processos, causa a parada da CPU
-  int err_int;
-  // com suporte a processos, deveria pegar o valor do registrador erro
-  //   no descritor do processo corrente, e reagir de acordo com esse erro
-  //   (em geral, matando o processo)
-  mem_le(self->mem, IRQ_END_erro, &err_int);
-  err_t err = err_int;
+  processo_t *proc = self->corrente;
+  if (proc == NULL) return ERR_OK;
+  err_t err = proc->erro;
+  // acesso a uma página do programa que não está na memória principal:
+  //   pede a página ao disco, e o processo espera a leitura terminar
+  //   para executar de novo a instrução que causou a falta
+  if (err == ERR_PAG_AUSENTE || err == ERR_END_INV) {
+    if (so_trata_falta_de_pagina(self, proc, proc->complemento)) {
+      proc->erro = ERR_OK;
+      return ERR_OK;
+    }
+  }
+  // escrita em página compartilhada: o processo ganha uma cópia dela, e
+  //   executa de novo a instrução
+  if (err == ERR_PROTECAO) {
+    if (so_trata_violacao(self, proc, proc->complemento)) {
+      proc->erro = ERR_OK;
+      return ERR_OK;
+    }
+  }
   console_printf(self->console,
-      "SO: IRQ não tratada -- erro na CPU: %s", err_nome(err));
-  return ERR_CPU_PARADA;
+      "SO: processo %d morto por erro na CPU: %s", proc->pid, err_nome(err));
+  so_mata_processo(self, proc);
+  return ERR_OK;
 }
 
 static err_t so_trata_irq_relogio(so_t *self)
@@ -236,9 +568,21 @@ static err_t so_trata_irq_relogio(so_t *self)
   rel_escr(self->relogio, 3, 0); // desliga o sinalizador de interrupção
   rel_escr(self->relogio, 2, INTERVALO_INTERRUPCAO);
   // trata a interrupção
-  // por exemplo, decrementa o quantum do processo corrente, quando se tem
-  // um escalonador com quantum
-  console_printf(self->console, "SO: interrupção do relógio (não tratada)");
+  // o tempo virtual e o quantum só passam para o processo que estava
+  //   executando
+  if (self->corrente != NULL) {
+    self->corrente->t_virtual++;
+    self->quantum--;
+  }
+  so_atualiza_acessos(self);
+  return ERR_OK;
+}
+
+static err_t so_trata_irq_disco(so_t *self)
+{
+  // o disco terminou a transferência que estava fazendo
+  disco_escr(self->disco, 5, 0); // desliga o sinalizador de interrupção
+  so_termina_transferencia(self);
   return ERR_OK;
 }
 
@@ -251,41 +595,50 @@ static err_t so_trata_irq_desconhecida(so_t *self, int irq)
 
 // Chamadas de sistema
 
-static void so_chamada_le(so_t *self);
-static void so_chamada_escr(so_t *self);
-static void so_chamada_cria_proc(so_t *self);
-static void so_chamada_mata_proc(so_t *self);
+static void so_chamada_le(so_t *self, processo_t *proc);
+static void so_chamada_escr(so_t *self, processo_t *proc);
+static void so_chamada_cria_proc(so_t *self, processo_t *proc);
+static void so_chamada_mata_proc(so_t *self, processo_t *proc);
+static void so_chamada_espera_proc(so_t *self, processo_t *proc);
+static void so_chamada_fork(so_t *self, processo_t *proc);
 
 static err_t so_trata_chamada_sistema(so_t *self)
 {
-  // com processos, a identificação da chamada está no reg A no descritor
-  //   do processo
-  int id_chamada;
-  mem_le(self->mem, IRQ_END_A, &id_chamada);
+  // a identificação da chamada está no reg A no descritor do processo
+  processo_t *proc = self->corrente;
+  if (proc == NULL) return ERR_OK;
+  int id_chamada = proc->A;
   console_printf(self->console,
       "SO: chamada de sistema %d", id_chamada);
   switch (id_chamada) {
     case SO_LE:
-      so_chamada_le(self);
+      so_chamada_le(self, proc);
       break;
     case SO_ESCR:
-      so_chamada_escr(self);
+      so_chamada_escr(self, proc);
       break;
     case SO_CRIA_PROC:
-      so_chamada_cria_proc(self);
+      so_chamada_cria_proc(self, proc);
       break;
     case SO_MATA_PROC:
-      so_chamada_mata_proc(self);
+      so_chamada_mata_proc(self, proc);
+      break;
+    case SO_ESPERA_PROC:
+      so_chamada_espera_proc(self, proc);
+      break;
+    case SO_FORK:
+      so_chamada_fork(self, proc);
       break;
     default:
       console_printf(self->console,
-          "SO: chamada de sistema desconhecida (%d)", id_chamada);
-      return ERR_CPU_PARADA;
+          "SO: chamada de sistema desconhecida (%d), processo %d morto",
+          id_chamada, proc->pid);
+      so_mata_processo(self, proc);
   }
   return ERR_OK;
 }
 
-static void so_chamada_le(so_t *self)
+static void so_chamada_le(so_t *self, processo_t *proc)
 {
   // implementação com espera ocupada
   //   deveria bloquear o processo se leitura não disponível.
@@ -293,11 +646,12 @@ static void so_chamada_le(so_t *self)
   //   ser feita mais tarde, em tratamentos pendentes em outra interrupção,
   //   ou diretamente em uma interrupção específica do dispositivo, se for
   //   o caso
-  // implementação lendo direto do terminal A
+  // implementação lendo direto do terminal do processo
   //   deveria usar dispositivo corrente de entrada do processo
+  int terminal = proc->terminal * 4;
   for (;;) {
     int estado;
-    term_le(self->console, 1, &estado);
+    term_le(self->console, terminal + 1, &estado);
     if (estado != 0) break;
     // como não está saindo do SO, o laço do processador não tá rodando
     // esta gambiarra faz o console andar
@@ -306,147 +660,1093 @@ static void so_chamada_le(so_t *self)
     console_tictac(self->console);
     console_atualiza(self->console);
   }
-  int dado;
-  term_le(self->console, 0, &dado);
-  // com processo, deveria escrever no reg A do processo
-  mem_escreve(self->mem, IRQ_END_A, dado);
+  term_le(self->console, terminal + 0, &proc->A);
 }
 
-static void so_chamada_escr(so_t *self)
+static void so_chamada_escr(so_t *self, processo_t *proc)
 {
   // implementação com espera ocupada
   //   deveria bloquear o processo se dispositivo ocupado
-  // implementação escrevendo direto do terminal A
+  // implementação escrevendo direto no terminal do processo
   //   deveria usar dispositivo corrente de saída do processo
+  int terminal = proc->terminal * 4;
   for (;;) {
     int estado;
-    term_le(self->console, 3, &estado);
+    term_le(self->console, terminal + 3, &estado);
     if (estado != 0) break;
     // como não está saindo do SO, o laço do processador não tá rodando
     // esta gambiarra faz o console andar
     console_tictac(self->console);
     console_atualiza(self->console);
   }
-  int dado;
-  mem_le(self->mem, IRQ_END_X, &dado);
-  term_escr(self->console, 2, dado);
-  mem_escreve(self->mem, IRQ_END_A, 0);
+  term_escr(self->console, terminal + 2, proc->X);
+  proc->A = 0;
 }
 
-static void so_chamada_cria_proc(so_t *self)
+static void so_chamada_cria_proc(so_t *self, processo_t *proc)
 {
-  // ainda sem suporte a processos, carrega programa e passa a executar ele
-  // quem chamou o sistema não vai mais ser executado, coitado!
-
   // em X está o endereço onde está o nome do arquivo
-  int ender_proc;
-  // deveria ler o X do descritor do processo criador
-  if (mem_le(self->mem, IRQ_END_X, &ender_proc) == ERR_OK) {
-    char nome[100];
-    if (so_copia_str_do_processo(self, 100, nome, ender_proc)) {
-      int ender_carga = so_carrega_programa(self, nome);
-      // o endereço de carga é endereço virtual, deve ser 0
-      if (ender_carga >= 0) {
-        // deveria escrever no PC do descritor do processo criado
-        mem_escreve(self->mem, IRQ_END_PC, ender_carga);
-        return;
+  char nome[100];
+  bool falta;
+  if (so_copia_str_do_processo(self, 100, nome, proc->X, proc, &falta)) {
+    processo_t *novo = so_cria_processo(self, nome);
+    if (novo != NULL) {
+      proc->A = novo->pid;
+      return;
+    }
+  } else if (falta) {
+    // o nome está em uma página que não está na memória principal; a
+    //   chamada vai ser executada de novo quando o processo voltar a
+    //   executar (o PC salvo aponta para depois da instrução CHAMAS)
+    proc->PC--;
+    return;
+  }
+  proc->A = -1;
+}
+
+static void so_chamada_mata_proc(so_t *self, processo_t *proc)
+{
+  // em X está o pid do processo a matar, ou 0 para o próprio
+  processo_t *vitima = proc;
+  if (proc->X != 0) {
+    vitima = so_busca_processo(self, proc->X);
+  }
+  if (vitima == NULL) {
+    proc->A = -1;
+    return;
+  }
+  if (vitima != proc) proc->A = 0;
+  so_mata_processo(self, vitima);
+}
+
+static void so_chamada_espera_proc(so_t *self, processo_t *proc)
+{
+  // em X está o pid do processo a esperar; o processo fica bloqueado até
+  //   ele morrer (ver so_mata_processo)
+  processo_t *esperado = so_busca_processo(self, proc->X);
+  if (esperado == NULL || esperado == proc) {
+    proc->A = -1;
+    return;
+  }
+  proc->estado = BLOQUEADO;
+  proc->espera = ESPERA_PROC;
+  proc->pid_esperado = esperado->pid;
+}
+
+static void so_chamada_fork(so_t *self, processo_t *proc)
+{
+  // o processo criado recebe 0 em A (ver so_clona_processo)
+  processo_t *filho = so_clona_processo(self, proc);
+  if (filho == NULL) {
+    proc->A = -1;
+  } else {
+    proc->A = filho->pid;
+  }
+}
+
+
+// Processos
+
+// retorna uma entrada livre da tabela de processos, ou NULL se não tiver
+static processo_t *so_descritor_livre(so_t *self)
+{
+  for (int i = 0; i < MAX_PROCESSOS; i++) {
+    if (self->processos[i].pid == 0) return &self->processos[i];
+  }
+  console_printf(self->console, "SO: tabela de processos cheia");
+  return NULL;
+}
+
+// inicializa o descritor de um processo que vai começar a executar em 'PC'
+static void so_inicia_descritor(so_t *self, processo_t *proc, int PC)
+{
+  proc->pid = self->prox_pid++;
+  proc->estado = PRONTO;
+  proc->PC = PC;
+  proc->A = 0;
+  proc->X = 0;
+  proc->erro = ERR_OK;
+  proc->complemento = 0;
+  proc->terminal = (proc->pid - 1) % N_TERM;
+  proc->t_virtual = 0;
+}
+
+// cria um processo para executar o programa
+// retorna o descritor do processo, ou NULL se não foi possível
+static processo_t *so_cria_processo(so_t *self, char *nome_do_executavel)
+{
+  processo_t *proc = so_descritor_livre(self);
+  if (proc == NULL) return NULL;
+  proc->tabpag = tabpag_cria();
+  if (proc->tabpag == NULL) return NULL;
+  int ender_carga = so_carrega_programa(self, proc, nome_do_executavel);
+  if (ender_carga < 0) {
+    tabpag_destroi(proc->tabpag);
+    return NULL;
+  }
+  so_inicia_descritor(self, proc, ender_carga);
+  console_printf(self->console,
+      "SO: processo %d criado para '%s'", proc->pid, nome_do_executavel);
+  return proc;
+}
+
+// cria um processo que é uma cópia do processo 'pai', continuando a
+//   execução no mesmo ponto, com os mesmos registradores (menos o A, que
+//   é 0) e a mesma memória
+// a memória não é copiada: o filho passa a usar os mesmos blocos do disco
+//   que o pai, e as páginas que estão na memória principal são mapeadas
+//   na tabela do filho nos mesmos quadros, sem permissão de escrita nas
+//   duas tabelas (ver so_copia_na_escrita)
+// retorna o descritor do processo, ou NULL se não foi possível
+static processo_t *so_clona_processo(so_t *self, processo_t *pai)
+{
+  processo_t *filho = so_descritor_livre(self);
+  if (filho == NULL) return NULL;
+  filho->tabpag = tabpag_cria();
+  if (filho->tabpag == NULL) return NULL;
+  int n_paginas = pai->pagina_fim - pai->pagina_ini + 1;
+  filho->blocos = malloc(n_paginas * sizeof(int));
+  if (filho->blocos == NULL) {
+    tabpag_destroi(filho->tabpag);
+    return NULL;
+  }
+  filho->pagina_ini = pai->pagina_ini;
+  filho->pagina_fim = pai->pagina_fim;
+  for (int i = 0; i < n_paginas; i++) {
+    filho->blocos[i] = pai->blocos[i];
+    if (pai->blocos[i] != -1) self->disco_refs[pai->blocos[i]]++;
+  }
+  unsigned bit_pai = so_bit_do_processo(self, pai);
+  for (int quadro = 0; quadro < self->n_quadros_usados; quadro++) {
+    if (self->quadros[quadro].donos & bit_pai) {
+      so_compartilha_quadro(self, quadro, filho);
+    }
+  }
+  so_inicia_descritor(self, filho, pai->PC);
+  filho->X = pai->X;
+  console_printf(self->console,
+      "SO: processo %d criado como cópia do processo %d",
+      filho->pid, pai->pid);
+  return filho;
+}
+
+// mata o processo: libera os quadros, os blocos do disco e a tabela de
+//   páginas dele, e desbloqueia os processos que esperavam sua morte
+static void so_mata_processo(so_t *self, processo_t *proc)
+{
+  console_printf(self->console, "SO: processo %d morreu", proc->pid);
+  so_libera_quadros(self, proc);
+  // as leituras pedidas para ele não vão ser mapeadas
+  for (pedido_t *pedido = self->pedidos; pedido != NULL;
+       pedido = pedido->prox) {
+    if (pedido->dono == proc) pedido->dono = NULL;
+    pedido->outros &= ~so_bit_do_processo(self, proc);
+  }
+  tabpag_destroi(proc->tabpag);
+  for (int i = 0; i <= proc->pagina_fim - proc->pagina_ini; i++) {
+    if (proc->blocos[i] != -1) so_solta_bloco(self, proc->blocos[i], 1);
+  }
+  free(proc->blocos);
+  for (int i = 0; i < MAX_PROCESSOS; i++) {
+    processo_t *outro = &self->processos[i];
+    if (outro->pid != 0 && outro->estado == BLOQUEADO
+        && outro->espera == ESPERA_PROC && outro->pid_esperado == proc->pid) {
+      outro->estado = PRONTO;
+      outro->A = 0;
+    }
+  }
+  if (self->corrente == proc) self->corrente = NULL;
+  proc->pid = 0;
+}
+
+// retorna o descritor do processo com o pid, ou NULL se não existir
+static processo_t *so_busca_processo(so_t *self, int pid)
+{
+  if (pid <= 0) return NULL;
+  for (int i = 0; i < MAX_PROCESSOS; i++) {
+    if (self->processos[i].pid == pid) return &self->processos[i];
+  }
+  return NULL;
+}
+
+
+// retorna a imagem do programa na tabela de imagens, ou NULL se não tiver
+static imagem_t *so_busca_imagem(so_t *self, char *nome_do_executavel)
+{
+  for (int i = 0; i < self->n_imagens; i++) {
+    if (strcmp(self->imagens[i].nome, nome_do_executavel) == 0) {
+      return &self->imagens[i];
+    }
+  }
+  return NULL;
+}
+
+// tira a imagem da tabela de imagens, com as referências dela aos blocos
+//   do disco e ao programa; os processos que usam os blocos continuam com
+//   eles, e os blocos ficam livres quando o último deles morrer
+static void so_descarta_imagem(so_t *self, imagem_t *img)
+{
+  int n_paginas = img->end_fim / self->tam_pagina
+                  - img->end_ini / self->tam_pagina + 1;
+  for (int i = 0; i < n_paginas; i++) {
+    if (img->blocos[i] != -1) so_solta_bloco(self, img->blocos[i], 1);
+  }
+  free(img->blocos);
+  prog_destroi(img->prog);
+  *img = self->imagens[--self->n_imagens];
+}
+
+// descarta as imagens que não são usadas por nenhum processo (os blocos
+//   delas só têm a referência da tabela), liberando os blocos
+static void so_descarta_imagens_sem_uso(so_t *self)
+{
+  for (int i = self->n_imagens - 1; i >= 0; i--) {
+    imagem_t *img = &self->imagens[i];
+    int n_paginas = img->end_fim / self->tam_pagina
+                    - img->end_ini / self->tam_pagina + 1;
+    bool em_uso = false;
+    for (int j = 0; j < n_paginas; j++) {
+      if (img->blocos[j] != -1 && self->disco_refs[img->blocos[j]] > 1) {
+        em_uso = true;
       }
     }
+    if (!em_uso) {
+      console_printf(self->console,
+          "SO: imagem de '%s' descartada para liberar o disco", img->nome);
+      so_descarta_imagem(self, img);
+    }
   }
-  // deveria escrever -1 (se erro) ou o PID do processo criado (se OK) no reg A
-  //   do processo que pediu a criação
-  mem_escreve(self->mem, IRQ_END_A, -1);
 }
 
-static void so_chamada_mata_proc(so_t *self)
+// retorna true se todas as posições do programa na página estão em faixas
+//   zeradas (ver prog_faixa_zerada)
+static bool so_pagina_zerada(so_t *self, programa_t *prog, int pagina)
 {
-  // ainda sem suporte a processos, retorna erro -1
-  console_printf(self->console, "SO: SO_MATA_PROC não implementada");
-  mem_escreve(self->mem, IRQ_END_A, -1);
+  int ini = pagina * self->tam_pagina;
+  int fim = ini + self->tam_pagina - 1;
+  int prog_ini = prog_end_carga(prog);
+  int prog_fim = prog_ini + prog_tamanho(prog) - 1;
+  if (ini < prog_ini) ini = prog_ini;
+  if (fim > prog_fim) fim = prog_fim;
+  int zeradas = 0;
+  for (int faixa = 0; faixa < prog_n_faixas_zeradas(prog); faixa++) {
+    int inicio, tam;
+    prog_faixa_zerada(prog, faixa, &inicio, &tam);
+    int de = inicio > ini ? inicio : ini;
+    int ate = inicio + tam - 1 < fim ? inicio + tam - 1 : fim;
+    if (ate >= de) zeradas += ate - de + 1;
+  }
+  return zeradas == fim - ini + 1;
 }
 
+// copia o programa para o disco, preenchendo '*img'; as páginas que só
+//   têm zeros não são copiadas, e ficam sem bloco
+// retorna false se não foi possível
+// os blocos vêm de so_aloca_bloco; se não tiver blocos livres suficientes,
+//   as imagens que não estão em uso são descartadas antes (ver
+//   so_descarta_imagens_sem_uso); o programa é escrito diretamente no
+//   conteúdo do disco, como se tivesse sido instalado lá
+static bool so_instala_imagem(so_t *self, char *nome_do_executavel,
+                              programa_t *prog, imagem_t *img)
+{
+  int end_virt_ini = prog_end_carga(prog);
+  int end_virt_fim = end_virt_ini + prog_tamanho(prog) - 1;
+  int pagina_ini = end_virt_ini / self->tam_pagina;
+  int pagina_fim = end_virt_fim / self->tam_pagina;
+  int n_paginas = pagina_fim - pagina_ini + 1;
+  int *blocos = malloc(n_paginas * sizeof(int));
+  if (blocos == NULL) return false;
+  int n_blocos = 0;
+  for (int i = 0; i < n_paginas; i++) {
+    if (!so_pagina_zerada(self, prog, pagina_ini + i)) n_blocos++;
+  }
+  if (n_blocos > self->n_blocos_livres + self->n_blocos - self->bloco_livre) {
+    so_descarta_imagens_sem_uso(self);
+  }
+  if (n_blocos > self->n_blocos_livres + self->n_blocos - self->bloco_livre) {
+    console_printf(self->console,
+        "SO: sem espaço no disco para '%s'", nome_do_executavel);
+    free(blocos);
+    return false;
+  }
+  for (int i = 0; i < n_paginas; i++) {
+    if (so_pagina_zerada(self, prog, pagina_ini + i)) {
+      blocos[i] = -1;
+    } else {
+      blocos[i] = so_aloca_bloco(self);
+    }
+  }
+
+  // copia o programa para o disco, em trechos de dados seguidos (ver
+  //   prog_dados); o que não está em um trecho (inclusive o que completa
+  //   a primeira e a última página) é zero
+  mem_t *disco = disco_conteudo(self->disco);
+  for (int i = 0; i < n_paginas; i++) {
+    if (blocos[i] == -1) continue;
+    int end_disco = blocos[i] * self->tam_pagina;
+    int end_virt = (pagina_ini + i) * self->tam_pagina;
+    // as posições fora dos trechos com dados ficam com zero
+    mem_preenche(disco, end_disco, self->tam_pagina, 0);
+    int desloc = 0;
+    while (desloc < self->tam_pagina) {
+      int *dados;
+      int n = prog_dados(prog, end_virt + desloc, &dados);
+      if (n == 0) {
+        desloc++;
+        continue;
+      }
+      if (n > self->tam_pagina - desloc) n = self->tam_pagina - desloc;
+      mem_copia_para(disco, end_disco + desloc, n, dados);
+      desloc += n;
+    }
+  }
 
-// carrega o programa na memória
+  strncpy(img->nome, nome_do_executavel, sizeof(img->nome) - 1);
+  img->nome[sizeof(img->nome) - 1] = '\0';
+  img->prog = prog;
+  img->end_ini = end_virt_ini;
+  img->end_fim = end_virt_fim;
+  img->blocos = blocos;
+  return true;
+}
+
+// carrega o programa na memória secundária, no espaço de endereçamento
+//   do processo
 // retorna o endereço de carga ou -1
-// está simplesmente lendo para o próximo quadro que nunca foi ocupado,
-//   nem testa se tem memória disponível
-// com memória virtual, a forma mais simples de implementar a carga
-//   de um programa é carregá-lo para a memória secundária, e mapear
-//   todas as páginas da tabela de páginas como inválidas. assim, 
-//   as páginas serão colocadas na memória principal por demanda.
-//   para simplificar ainda mais, a memória secundária pode ser alocada
-//   da forma como a principal está sendo alocada aqui (sem reuso)
-static int so_carrega_programa(so_t *self, char *nome_do_executavel)
-{
-  // programa para executar na nossa CPU
+// se o programa já tem imagem no disco, e o arquivo não mudou desde que
+//   ela foi feita, o processo usa os blocos dela; senão, o programa é
+//   instalado no disco, e a imagem é guardada (se couber na tabela de
+//   imagens)
+// todas as páginas ficam ausentes na tabela de páginas, e são colocadas
+//   na memória principal por demanda (ver so_trata_falta_de_pagina), a não
+//   ser as da imagem que estão em quadros de outros processos e ainda não
+//   foram alteradas, que são compartilhadas com eles
+static int so_carrega_programa(so_t *self, processo_t *proc,
+                               char *nome_do_executavel)
+{
+  // programa para executar na nossa CPU; se o arquivo não mudou, vem da
+  //   cache, sem ler o arquivo (ver prog_cria)
   programa_t *prog = prog_cria(nome_do_executavel);
   if (prog == NULL) {
     console_printf(self->console,
         "Erro na leitura do programa '%s'\n", nome_do_executavel);
     return -1;
   }
+  imagem_t nova;
+  imagem_t *img = so_busca_imagem(self, nome_do_executavel);
+  if (img != NULL && img->prog != prog) {
+    console_printf(self->console,
+        "SO: '%s' foi alterado, imagem descartada", nome_do_executavel);
+    so_descarta_imagem(self, img);
+    img = NULL;
+  }
+  bool ja_instalada = img != NULL;
+  if (!ja_instalada) {
+    if (!so_instala_imagem(self, nome_do_executavel, prog, &nova)) {
+      prog_destroi(prog);
+      return -1;
+    }
+    img = &nova;
+  }
+  int pagina_ini = img->end_ini / self->tam_pagina;
+  int pagina_fim = img->end_fim / self->tam_pagina;
+  int n_paginas = pagina_fim - pagina_ini + 1;
+  proc->blocos = malloc(n_paginas * sizeof(int));
+  if (proc->blocos == NULL) {
+    if (img == &nova) free(nova.blocos);
+    prog_destroi(prog);
+    return -1;
+  }
+  proc->pagina_ini = pagina_ini;
+  proc->pagina_fim = pagina_fim;
+  int n_blocos = 0;
+  for (int i = 0; i < n_paginas; i++) {
+    int bloco = img->blocos[i];
+    proc->blocos[i] = bloco;
+    if (bloco == -1) continue;
+    self->disco_refs[bloco]++;
+    n_blocos++;
+  }
 
-  int end_virt_ini = prog_end_carga(prog);
-  int end_virt_fim = end_virt_ini + prog_tamanho(prog) - 1;
-  int pagina_ini = end_virt_ini / TAM_PAGINA;
-  int pagina_fim = end_virt_fim / TAM_PAGINA;
-  int quadro_ini = self->quadro_livre;
-  // mapeia as páginas nos quadros
-  int quadro = quadro_ini;
-  for (int pagina = pagina_ini; pagina <= pagina_fim; pagina++) {
-    tabpag_define_quadro(self->tabpag, pagina, quadro);
-    quadro++;
-  }
-  self->quadro_livre = quadro;
-
-  // carrega o programa na memória principal
-  int end_fis_ini = quadro_ini * TAM_PAGINA;
-  int end_fis = end_fis_ini;
-  for (int end_virt = end_virt_ini; end_virt <= end_virt_fim; end_virt++) {
-    if (mem_escreve(self->mem, end_fis, prog_dado(prog, end_virt)) != ERR_OK) {
+  if (ja_instalada) {
+    for (int quadro = 0; quadro < self->n_quadros_usados; quadro++) {
+      quadro_t *q = &self->quadros[quadro];
+      if (q->donos == 0 || so_quadro_alterado(self, quadro)) continue;
+      if (q->pagina < pagina_ini || q->pagina > pagina_fim) continue;
+      int i = 0;
+      int bloco = *so_bloco(so_proximo_dono(self, q, &i), q->pagina);
+      if (bloco != -1 && bloco == img->blocos[q->pagina - pagina_ini]) {
+        so_compartilha_quadro(self, quadro, proc);
+      }
+    }
+  } else if (self->n_imagens < MAX_IMAGENS
+             && strcmp(nova.nome, nome_do_executavel) == 0) {
+    img = &self->imagens[self->n_imagens++];
+    *img = nova;
+    for (int i = 0; i < n_paginas; i++) {
+      if (img->blocos[i] != -1) self->disco_refs[img->blocos[i]]++;
+    }
+  }
+
+  console_printf(self->console,
+      "SO: carga de '%s' em V%d-%d, %d blocos do disco%s",
+                 nome_do_executavel, img->end_ini, img->end_fim, n_blocos,
+                 ja_instalada ? " (imagem já no disco)" : "");
+  int end_ini = img->end_ini;
+  // a imagem que foi para a tabela fica com a referência ao programa; a
+  //   que não coube não é mais usada
+  if (img == &nova) free(nova.blocos);
+  if (img == &nova || ja_instalada) prog_destroi(prog);
+  return end_ini;
+}
+
+// retorna true se o endereço virtual está em uma página do programa do
+//   processo
+static bool so_pagina_do_programa(so_t *self, processo_t *proc,
+                                  int end_virt)
+{
+  if (end_virt < 0) return false;
+  int pagina = end_virt / self->tam_pagina;
+  return pagina >= proc->pagina_ini && pagina <= proc->pagina_fim;
+}
+
+// bloco do disco onde está a página 'pagina' do programa do processo
+static int *so_bloco(processo_t *proc, int pagina)
+{
+  return &proc->blocos[pagina - proc->pagina_ini];
+}
+
+// retorna um bloco livre do disco, sem referências, ou -1 se o disco
+//   estiver cheio
+static int so_aloca_bloco(so_t *self)
+{
+  if (self->n_blocos_livres > 0) {
+    return self->blocos_livres[--self->n_blocos_livres];
+  }
+  if (self->bloco_livre >= self->n_blocos) return -1;
+  return self->bloco_livre++;
+}
+
+// retorna true se tem pedido na fila do disco para o bloco
+static bool so_bloco_tem_pedido(so_t *self, int bloco)
+{
+  for (pedido_t *pedido = self->pedidos; pedido != NULL;
+       pedido = pedido->prox) {
+    if (pedido->end_disco / self->tam_pagina == bloco) return true;
+  }
+  return false;
+}
+
+// tira 'n_refs' referências ao bloco do disco; se não sobrar nenhuma, o
+//   bloco fica livre
+// se ainda tem pedido na fila do disco para o bloco, ele só fica livre
+//   quando o pedido terminar (ver so_termina_transferencia), para uma
+//   gravação atrasada não sobrescrever o que for colocado nele depois
+static void so_solta_bloco(so_t *self, int bloco, int n_refs)
+{
+  self->disco_refs[bloco] -= n_refs;
+  if (self->disco_refs[bloco] == 0 && !so_bloco_tem_pedido(self, bloco)) {
+    self->blocos_livres[self->n_blocos_livres++] = bloco;
+  }
+}
+
+// endereço na memória principal do início do quadro 'quadro' da tabela
+static int so_end_quadro(so_t *self, int quadro)
+{
+  return (self->primeiro_quadro + quadro) * self->tam_pagina;
+}
+
+// bit que representa o processo no conjunto de donos de um quadro
+static unsigned so_bit_do_processo(so_t *self, processo_t *proc)
+{
+  return 1u << (proc - self->processos);
+}
+
+// retorna o próximo dono do quadro a partir da posição '*pi' da tabela de
+//   processos, avançando '*pi' para depois dele, ou NULL se não tiver mais
+static processo_t *so_proximo_dono(so_t *self, quadro_t *q, int *pi)
+{
+  while (*pi < MAX_PROCESSOS) {
+    int i = (*pi)++;
+    if (q->donos & (1u << i)) return &self->processos[i];
+  }
+  return NULL;
+}
+
+// coloca um pedido de transferência na fila do disco, e inicia a
+//   transferência se o disco estiver livre
+static void so_pede_transferencia(so_t *self, int comando, int quadro,
+                                  int end_disco, int pagina,
+                                  processo_t *dono)
+{
+  pedido_t *pedido = malloc(sizeof(*pedido));
+  if (pedido == NULL) {
+    console_printf(self->console, "SO: sem memória para pedido ao disco");
+    return;
+  }
+  pedido->comando = comando;
+  pedido->quadro = quadro;
+  pedido->end_disco = end_disco;
+  pedido->pagina = pagina;
+  pedido->dono = dono;
+  pedido->outros = 0;
+  pedido->prox = NULL;
+  if (self->pedidos == NULL) {
+    self->pedidos = pedido;
+  } else {
+    self->ultimo_pedido->prox = pedido;
+  }
+  self->ultimo_pedido = pedido;
+  if (self->pedidos == pedido) {
+    so_inicia_transferencia(self);
+  }
+}
+
+// passa para o disco o primeiro pedido da fila
+static void so_inicia_transferencia(so_t *self)
+{
+  pedido_t *pedido = self->pedidos;
+  disco_escr(self->disco, 0, pedido->end_disco);
+  disco_escr(self->disco, 1, so_end_quadro(self, pedido->quadro));
+  disco_escr(self->disco, 2, self->tam_pagina);
+  if (disco_escr(self->disco, 3, pedido->comando) != ERR_OK) {
+    console_printf(self->console, "SO: disco não aceitou o pedido");
+  }
+}
+
+// o disco terminou o primeiro pedido da fila: se for leitura, a página
+//   passa a estar no quadro e o processo dono dela é desbloqueado; inicia
+//   o próximo pedido, se tiver
+static void so_termina_transferencia(so_t *self)
+{
+  pedido_t *pedido = self->pedidos;
+  if (pedido == NULL) return;
+  int resultado;
+  disco_le(self->disco, 6, &resultado);
+  if (resultado != ERR_OK) {
+    console_printf(self->console,
+        "SO: erro na transferência com o disco: %s", err_nome(resultado));
+  }
+  self->pedidos = pedido->prox;
+  quadro_t *q = &self->quadros[pedido->quadro];
+  if (pedido->comando == DISCO_LE) {
+    q->reservado = false;
+    processo_t *dono = pedido->dono;
+    unsigned outros = pedido->outros;
+    // se o processo morreu enquanto esperava, um dos outros que esperam a
+    //   página fica no lugar dele; se não tiver nenhum, o quadro fica livre
+    for (int i = 0; dono == NULL && i < MAX_PROCESSOS; i++) {
+      if (outros & (1u << i)) {
+        dono = &self->processos[i];
+        outros &= ~(1u << i);
+      }
+    }
+    if (dono != NULL) {
+      tabpag_define_quadro(dono->tabpag, pedido->pagina,
+                           self->primeiro_quadro + pedido->quadro);
+      q->donos = so_bit_do_processo(self, dono);
+      q->pagina = pedido->pagina;
+      q->alterada = false;
+      subst_carregou(self->subst, pedido->quadro);
+      dono->estado = PRONTO;
       console_printf(self->console,
-          "Erro na carga da memória, end virt %d fís %d\n", end_virt, end_fis);
-      return -1;
+          "SO: página %d do processo %d carregada no quadro %d",
+          pedido->pagina, dono->pid, self->primeiro_quadro + pedido->quadro);
+      // os outros passam a compartilhar o quadro, sem permissão de escrita
+      for (int i = 0; i < MAX_PROCESSOS; i++) {
+        if ((outros & (1u << i)) == 0) continue;
+        processo_t *outro = &self->processos[i];
+        so_compartilha_quadro(self, pedido->quadro, outro);
+        outro->estado = PRONTO;
+        console_printf(self->console,
+            "SO: página %d do processo %d compartilhada no quadro %d",
+            pedido->pagina, outro->pid,
+            self->primeiro_quadro + pedido->quadro);
+      }
+    }
+  } else {
+    q->gravando--;
+    // quem esperava para alterar o quadro pode tentar de novo
+    if (q->gravando == 0) {
+      for (int i = 0; i < MAX_PROCESSOS; i++) {
+        processo_t *proc = &self->processos[i];
+        if (proc->pid != 0 && proc->estado == BLOQUEADO
+            && proc->espera == ESPERA_GRAVACAO
+            && proc->quadro_esperado == pedido->quadro) {
+          proc->estado = PRONTO;
+        }
+      }
+    }
+  }
+  // o bloco pode ter sido solto enquanto o pedido estava na fila
+  int bloco = pedido->end_disco / self->tam_pagina;
+  if (self->disco_refs[bloco] == 0 && !so_bloco_tem_pedido(self, bloco)) {
+    self->blocos_livres[self->n_blocos_livres++] = bloco;
+  }
+  free(pedido);
+  if (self->pedidos != NULL) {
+    so_inicia_transferencia(self);
+  }
+}
+
+// retorna true se a página que está no quadro foi alterada desde que foi
+//   lida ou gravada no disco, por qualquer um dos donos
+static bool so_quadro_alterado(so_t *self, int quadro)
+{
+  quadro_t *q = &self->quadros[quadro];
+  if (q->alterada) return true;
+  int i = 0;
+  processo_t *dono;
+  while ((dono = so_proximo_dono(self, q, &i)) != NULL) {
+    if (tabpag_bit_alteracao(dono->tabpag, q->pagina)) return true;
+  }
+  return false;
+}
+
+// pede ao disco a gravação da página que está no quadro
+// a página continua no quadro, e passa a ser considerada não alterada; a
+//   cópia é feita pelo disco quando chegar a vez do pedido, antes de
+//   qualquer leitura pedida depois para o mesmo quadro
+// se o bloco da página é usado também por processos que não são donos do
+//   quadro, ele não pode ser alterado: a página é gravada em um bloco novo,
+//   que passa a ser o dos donos; o mesmo acontece se a página ainda não
+//   tem bloco
+// retorna false se não tem bloco livre no disco; nesse caso nada é feito,
+//   e a página continua alterada no quadro
+static bool so_grava_pagina(so_t *self, int quadro)
+{
+  quadro_t *q = &self->quadros[quadro];
+  int i = 0;
+  processo_t *primeiro = so_proximo_dono(self, q, &i);
+  int n_donos = 1;
+  while (so_proximo_dono(self, q, &i) != NULL) n_donos++;
+  int bloco = *so_bloco(primeiro, q->pagina);
+  if (bloco == -1 || self->disco_refs[bloco] > n_donos) {
+    int novo = so_aloca_bloco(self);
+    if (novo == -1) {
+      console_printf(self->console,
+          "SO: sem espaço no disco para a página %d do processo %d",
+          q->pagina, primeiro->pid);
+      return false;
     }
-    end_fis++;
+    if (bloco != -1) so_solta_bloco(self, bloco, n_donos);
+    bloco = novo;
+    self->disco_refs[bloco] = n_donos;
+  }
+  so_pede_transferencia(self, DISCO_GRAVA, quadro, bloco * self->tam_pagina,
+                        q->pagina, NULL);
+  q->gravando++;
+  q->alterada = false;
+  // os bits de alteração são zerados em todas as tabelas
+  i = 0;
+  processo_t *dono;
+  while ((dono = so_proximo_dono(self, q, &i)) != NULL) {
+    *so_bloco(dono, q->pagina) = bloco;
+    tabpag_zera_bits(dono->tabpag, q->pagina);
+  }
+  self->n_gravacoes++;
+  console_printf(self->console,
+      "SO: página %d do processo %d sendo gravada no disco",
+      q->pagina, primeiro->pid);
+  return true;
+}
+
+// passa o processo a ser também dono da página que está no quadro,
+//   mapeando-a na tabela dele; a página perde a permissão de escrita
+//   para todos os donos (ver so_copia_na_escrita)
+static void so_compartilha_quadro(so_t *self, int quadro, processo_t *proc)
+{
+  quadro_t *q = &self->quadros[quadro];
+  q->donos |= so_bit_do_processo(self, proc);
+  tabpag_define_quadro(proc->tabpag, q->pagina,
+                       self->primeiro_quadro + quadro);
+  int i = 0;
+  processo_t *dono;
+  while ((dono = so_proximo_dono(self, q, &i)) != NULL) {
+    tabpag_define_permissoes(dono->tabpag, q->pagina, PERM_EXECUCAO);
+  }
+}
+
+// tira o processo dos donos do quadro, desfazendo o mapeamento da página
+//   na tabela dele; se era o último dono, o quadro fica livre
+static void so_tira_dono(so_t *self, int quadro, processo_t *proc)
+{
+  quadro_t *q = &self->quadros[quadro];
+  // uma alteração feita por ele continua valendo para os outros donos
+  if (tabpag_bit_alteracao(proc->tabpag, q->pagina)) q->alterada = true;
+  tabpag_define_quadro(proc->tabpag, q->pagina, -1);
+  q->donos &= ~so_bit_do_processo(self, proc);
+  if (q->donos == 0) {
+    q->pagina = -1;
+    q->alterada = false;
+    subst_liberou(self->subst, quadro);
+  }
+}
+
+// escolhe um quadro para receber uma página
+// se tiver quadro livre, é ele; senão, o algoritmo de substituição escolhe
+//   um, e a página que está nele é gravada no disco se tiver sido alterada
+//   (as não alteradas já estão atualizadas no disco)
+// retorna -1 se não tem quadro que possa ser usado; isso inclui o caso em
+//   que a página alterada do quadro escolhido não pode ser gravada (disco
+//   cheio): ela continua no quadro, para não ser perdida
+static int so_escolhe_quadro(so_t *self)
+{
+  for (int quadro = 0; quadro < self->n_quadros_usados; quadro++) {
+    quadro_t *q = &self->quadros[quadro];
+    if (q->pagina == -1 && !q->reservado) return quadro;
+  }
+  if (self->n_quadros_usados < self->n_quadros) {
+    quadro_t *q = &self->quadros[self->n_quadros_usados];
+    q->donos = 0;
+    q->pagina = -1;
+    q->reservado = false;
+    q->gravando = 0;
+    q->alterada = false;
+    return self->n_quadros_usados++;
+  }
+  int quadro = subst_escolhe(self->subst);
+  if (quadro == -1) return -1;
+  quadro_t *q = &self->quadros[quadro];
+  if (so_quadro_alterado(self, quadro) && !so_grava_pagina(self, quadro)) {
+    return -1;
   }
-  prog_destroi(prog);
+  int i = 0;
+  processo_t *dono;
+  while ((dono = so_proximo_dono(self, q, &i)) != NULL) {
+    so_tira_dono(self, quadro, dono);
+  }
+  return quadro;
+}
+
+// coloca no quadro uma página do processo que não tem bloco no disco,
+//   zerando o quadro; não precisa esperar o disco, a não ser que a
+//   gravação do que estava no quadro ainda esteja na fila: nesse caso o
+//   processo espera, e o acesso que causou a falta vai ser tentado de novo
+static void so_zera_pagina(so_t *self, processo_t *proc, int pagina,
+                           int quadro)
+{
+  quadro_t *q = &self->quadros[quadro];
+  if (q->gravando > 0) {
+    proc->estado = BLOQUEADO;
+    proc->espera = ESPERA_GRAVACAO;
+    proc->quadro_esperado = quadro;
+    return;
+  }
+  mem_preenche(self->mem, so_end_quadro(self, quadro), self->tam_pagina, 0);
+  tabpag_define_quadro(proc->tabpag, pagina, self->primeiro_quadro + quadro);
+  q->donos = so_bit_do_processo(self, proc);
+  q->pagina = pagina;
+  q->alterada = false;
+  subst_carregou(self->subst, quadro);
+  self->n_zeradas++;
+  console_printf(self->console,
+      "SO: página %d do processo %d zerada no quadro %d",
+      pagina, proc->pid, self->primeiro_quadro + quadro);
+}
+
+// reserva o quadro para a página do processo e pede a leitura dela ao
+//   disco; o processo fica bloqueado até a leitura terminar (ver
+//   so_termina_transferencia)
+// se a página não tem bloco, é zerada (ver so_zera_pagina)
+static void so_le_pagina(so_t *self, processo_t *proc, int pagina,
+                         int quadro)
+{
+  if (*so_bloco(proc, pagina) == -1) {
+    so_zera_pagina(self, proc, pagina, quadro);
+    return;
+  }
+  self->quadros[quadro].reservado = true;
+  so_pede_transferencia(self, DISCO_LE, quadro,
+                        *so_bloco(proc, pagina) * self->tam_pagina, pagina,
+                        proc);
+  proc->estado = BLOQUEADO;
+  proc->espera = ESPERA_PAGINA;
+  self->n_faltas_pag++;
   console_printf(self->console,
-      "SO: carga de '%s' em V%d-%d F%d-%d", nome_do_executavel,
-                 end_virt_ini, end_virt_fim, end_fis_ini, end_fis - 1);
-  return end_virt_ini;
+      "SO: falta de página %d do processo %d (%d faltas até agora)",
+      pagina, proc->pid, self->n_faltas_pag);
 }
 
+// trata a primeira escrita do processo em uma página compartilhada, que
+//   está no quadro 'origem': se ele é o único dono que sobrou, a página
+//   só passa a poder ser alterada; senão, ela é copiada para um quadro só
+//   dele
+static void so_copia_na_escrita(so_t *self, processo_t *proc, int pagina,
+                                int origem)
+{
+  quadro_t *q = &self->quadros[origem];
+  if (q->donos == so_bit_do_processo(self, proc)) {
+    tabpag_define_permissoes(proc->tabpag, pagina, PERM_TODAS);
+    return;
+  }
+  int quadro = so_escolhe_quadro(self);
+  if (quadro == -1) {
+    console_printf(self->console,
+        "SO: sem quadro para a página %d do processo %d", pagina, proc->pid);
+    return;
+  }
+  // a escolha pode ter tirado a página do quadro de origem (gravando-a no
+  //   disco, se alterada); nesse caso, ela é lida de novo
+  if ((q->donos & so_bit_do_processo(self, proc)) == 0) {
+    so_le_pagina(self, proc, pagina, quadro);
+    return;
+  }
+  // o quadro escolhido não pode ser alterado antes de sair da fila do disco
+  //   a gravação do que estava nele; o processo espera, e a escrita que
+  //   causou a falta vai ser tentada de novo
+  if (self->quadros[quadro].gravando > 0) {
+    proc->estado = BLOQUEADO;
+    proc->espera = ESPERA_GRAVACAO;
+    proc->quadro_esperado = quadro;
+    return;
+  }
+  const int *dados = mem_trecho(self->mem, so_end_quadro(self, origem),
+                               self->tam_pagina);
+  mem_copia_para(self->mem, so_end_quadro(self, quadro), self->tam_pagina,
+                 dados);
+  bool alterada = so_quadro_alterado(self, origem);
+  so_tira_dono(self, origem, proc);
+  tabpag_define_quadro(proc->tabpag, pagina, self->primeiro_quadro + quadro);
+  quadro_t *novo = &self->quadros[quadro];
+  novo->donos = so_bit_do_processo(self, proc);
+  novo->pagina = pagina;
+  novo->alterada = alterada;
+  subst_carregou(self->subst, quadro);
+  self->n_copias++;
+  console_printf(self->console,
+      "SO: página %d do processo %d copiada para o quadro %d",
+      pagina, proc->pid, self->primeiro_quadro + quadro);
+}
+
+// retorna o quadro onde está a página do bloco 'bloco' do disco, sem ter
+//   sido alterada, ou -1 se não tiver
+static int so_quadro_do_bloco(so_t *self, int bloco)
+{
+  for (int quadro = 0; quadro < self->n_quadros_usados; quadro++) {
+    quadro_t *q = &self->quadros[quadro];
+    if (q->donos == 0) continue;
+    int i = 0;
+    processo_t *dono = so_proximo_dono(self, q, &i);
+    if (*so_bloco(dono, q->pagina) == bloco
+        && !so_quadro_alterado(self, quadro)) {
+      return quadro;
+    }
+  }
+  return -1;
+}
+
+// retorna o pedido de leitura do bloco 'bloco' que está na fila do disco,
+//   ou NULL se não tiver
+static pedido_t *so_leitura_do_bloco(so_t *self, int bloco)
+{
+  for (pedido_t *pedido = self->pedidos; pedido != NULL;
+       pedido = pedido->prox) {
+    if (pedido->comando == DISCO_LE
+        && pedido->end_disco == bloco * self->tam_pagina) {
+      return pedido;
+    }
+  }
+  return NULL;
+}
+
+// trata o acesso a uma página do programa do processo que não está na
+//   memória principal: escolhe um quadro para ela e pede a leitura ao
+//   disco (ver so_le_pagina), a não ser que ela já esteja no quadro de
+//   outro processo, que passa a ser compartilhado, ou já esteja sendo lida
+//   para outro processo: nesse caso ele espera a mesma leitura, e passa a
+//   compartilhar o quadro quando ela terminar (ver so_termina_transferencia)
+// se não tiver quadro que possa ser usado (todos esperando leituras), o
+//   processo continua pronto, e vai causar a falta de novo
+// retorna false se o endereço não é do programa
+static bool so_trata_falta_de_pagina(so_t *self, processo_t *proc,
+                                     int end_virt)
+{
+  if (!so_pagina_do_programa(self, proc, end_virt)) return false;
+  int pagina = end_virt / self->tam_pagina;
+  int quadro;
+  // a página já foi mapeada, não tem o que fazer
+  if (tabpag_traduz(proc->tabpag, pagina, &quadro, NULL) == ERR_OK) {
+    return true;
+  }
+  // a página pode estar no quadro de outro processo que usa o mesmo bloco
+  //   (do mesmo programa, ou que é cópia do processo), sem alteração
+  int bloco = *so_bloco(proc, pagina);
+  quadro = bloco == -1 ? -1 : so_quadro_do_bloco(self, bloco);
+  if (quadro != -1) {
+    so_compartilha_quadro(self, quadro, proc);
+    return true;
+  }
+  pedido_t *leitura = bloco == -1 ? NULL : so_leitura_do_bloco(self, bloco);
+  if (leitura != NULL && leitura->pagina == pagina) {
+    leitura->outros |= so_bit_do_processo(self, proc);
+    proc->estado = BLOQUEADO;
+    proc->espera = ESPERA_PAGINA;
+    console_printf(self->console,
+        "SO: página %d do processo %d já está sendo lida para o quadro %d",
+        pagina, proc->pid, self->primeiro_quadro + leitura->quadro);
+    return true;
+  }
+  quadro = so_escolhe_quadro(self);
+  if (quadro == -1) {
+    console_printf(self->console,
+        "SO: sem quadro para a página %d do processo %d", pagina, proc->pid);
+    return true;
+  }
+  so_le_pagina(self, proc, pagina, quadro);
+  return true;
+}
+
+// trata um acesso do processo que as permissões da página não deixam
+//   fazer: se é uma página do programa sem permissão de escrita, está
+//   compartilhada com outro processo, e é feita a cópia na escrita (ver
+//   so_copia_na_escrita)
+// retorna false se o acesso não pode ser permitido
+static bool so_trata_violacao(so_t *self, processo_t *proc, int end_virt)
+{
+  if (!so_pagina_do_programa(self, proc, end_virt)) return false;
+  int pagina = end_virt / self->tam_pagina;
+  int quadro, permissoes;
+  if (tabpag_traduz(proc->tabpag, pagina, &quadro, &permissoes) != ERR_OK
+      || (permissoes & PERM_ESCRITA)) {
+    return false;
+  }
+  so_copia_na_escrita(self, proc, pagina, quadro - self->primeiro_quadro);
+  return true;
+}
+
+// retira da memória principal todas as páginas do processo
+static void so_libera_quadros(so_t *self, processo_t *proc)
+{
+  unsigned bit = so_bit_do_processo(self, proc);
+  for (int quadro = 0; quadro < self->n_quadros_usados; quadro++) {
+    if (self->quadros[quadro].donos & bit) {
+      so_tira_dono(self, quadro, proc);
+    }
+  }
+}
+
+// avisa o algoritmo de substituição das páginas acessadas desde a última
+//   vez, zerando o bit de acesso delas, e da passagem do tempo
+static void so_atualiza_acessos(so_t *self)
+{
+  int paginas[MAX_PAGINAS_COLETA];
+  for (int i = 0; i < MAX_PROCESSOS; i++) {
+    processo_t *proc = &self->processos[i];
+    if (proc->pid == 0) continue;
+    int n;
+    do {
+      n = tabpag_coleta_e_zera_bits(proc->tabpag, paginas,
+                                    MAX_PAGINAS_COLETA);
+      for (int j = 0; j < n; j++) {
+        int quadro;
+        if (tabpag_traduz(proc->tabpag, paginas[j], &quadro, NULL)
+            == ERR_OK) {
+          subst_acessou(self->subst, quadro - self->primeiro_quadro);
+        }
+      }
+    } while (n == MAX_PAGINAS_COLETA);
+  }
+  subst_tictac(self->subst);
+}
+
+// funções usadas pelo algoritmo de substituição para saber da página que
+//   está em um quadro (ver subst_ops_t)
+// a página está na tabela de cada processo dono do quadro; o tempo virtual
+//   de um quadro compartilhado é o do primeiro dono
+
+static bool so_subst_bit_acesso(void *arg, int quadro)
+{
+  so_t *self = arg;
+  quadro_t *q = &self->quadros[quadro];
+  int i = 0;
+  processo_t *dono;
+  while ((dono = so_proximo_dono(self, q, &i)) != NULL) {
+    if (tabpag_bit_acesso(dono->tabpag, q->pagina)) return true;
+  }
+  return false;
+}
+
+static void so_subst_zera_bit_acesso(void *arg, int quadro)
+{
+  so_t *self = arg;
+  quadro_t *q = &self->quadros[quadro];
+  int i = 0;
+  processo_t *dono;
+  while ((dono = so_proximo_dono(self, q, &i)) != NULL) {
+    tabpag_zera_bit_acesso(dono->tabpag, q->pagina);
+  }
+}
+
+static bool so_subst_bit_alteracao(void *arg, int quadro)
+{
+  so_t *self = arg;
+  return so_quadro_alterado(self, quadro);
+}
+
+static void so_subst_grava(void *arg, int quadro)
+{
+  so_t *self = arg;
+  // se já tem gravação da página na fila, ela vai sair atualizada
+  if (self->quadros[quadro].gravando) return;
+  // se não tiver espaço no disco, a página continua alterada
+  so_grava_pagina(self, quadro);
+}
+
+static int so_subst_tempo_virtual(void *arg, int quadro)
+{
+  so_t *self = arg;
+  int i = 0;
+  return so_proximo_dono(self, &self->quadros[quadro], &i)->t_virtual;
+}
+
+static const subst_ops_t so_subst_ops = {
+  .bit_acesso      = so_subst_bit_acesso,
+  .zera_bit_acesso = so_subst_zera_bit_acesso,
+  .bit_alteracao   = so_subst_bit_alteracao,
+  .grava           = so_subst_grava,
+  .tempo_virtual   = so_subst_tempo_virtual,
+};
+
 // copia uma string da memória do processo para o vetor str.
 // retorna false se erro (string maior que vetor, valor não ascii na memória,
 //   erro de acesso à memória)
-// o endereço é um endereço virtual de um processo.
-// Com processos e memória virtual implementados, esta função deve também
-//   receber o processo como argumento
-// Cada valor do espaço de endereçamento do processo pode estar em memória
-//   principal ou secundária
-// O endereço é um endereço virtual de um processo.
-// Com processos e memória virtual implementados, esta função deve também
-//   receber o processo como argumento
+// o endereço é um endereço virtual do processo, que tem que ser o
+//   corrente (a MMU está usando a tabela de páginas dele)
 // Com memória virtual, cada valor do espaço de endereçamento do processo
-//   pode estar em memória principal ou secundária
+//   pode estar em memória principal ou secundária; se estiver na
+//   secundária, a falta de página é tratada (o processo vai esperar a
+//   página), e '*pfalta' recebe true
 static bool so_copia_str_do_processo(so_t *self, int tam, char str[tam],
-                                     int end_virt/*, processo*/)
+                                     int end_virt, processo_t *proc,
+                                     bool *pfalta)
 {
-  for (int indice_str = 0; indice_str < tam; indice_str++) {
-    int caractere;
-    // não tem memória virtual implementada, posso usar a mmu para traduzir
-    //   os endereços e acessar a memória
-    if (mmu_le(self->mmu, end_virt + indice_str, &caractere, usuario) != ERR_OK) {
-      return false;
+  *pfalta = false;
+  // copia um trecho por vez, até o fim da página de cada um
+  int tam_pag = self->tam_pagina;
+  int indice_str = 0;
+  while (indice_str < tam) {
+    int end = end_virt + indice_str;
+    int n = tam_pag - end % tam_pag;
+    if (end < 0) n = 1;  // a MMU vai recusar o endereço
+    if (n > tam - indice_str) n = tam - indice_str;
+    int valores[n];
+    int copiados;
+    err_t err = mmu_copia_de(self->mmu, end, n, valores, usuario, &copiados);
+    for (int i = 0; i < copiados; i++) {
+      int caractere = valores[i];
+      if (caractere < 0 || caractere > 255) {
+        return false;
+      }
+      str[indice_str++] = caractere;
+      if (caractere == 0) {
+        return true;
+      }
     }
-    if (caractere < 0 || caractere > 255) {
+    if (err != ERR_OK) {
+      *pfalta = so_trata_falta_de_pagina(self, proc, end + copiados);
       return false;
     }
-    str[indice_str] = caractere;
-    if (caractere == 0) {
-      return true;
-    }
   }
   // estourou o tamanho de str
   return false;
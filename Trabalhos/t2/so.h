@@ -12,11 +12,27 @@ typedef struct so_t so_t;
 #include "cpu.h"
 #include "console.h"
 #include "relogio.h"
+#include "disco.h"
+#include "subst.h"
 
 so_t *so_cria(cpu_t *cpu, mem_t *mem, mmu_t *mmu,
-              console_t *console, relogio_t *relogio);
+              console_t *console, relogio_t *relogio, disco_t *disco);
 void so_destroi(so_t *self);
 
+// define o tamanho do conjunto de trabalho usado na substituição de
+//   páginas, em interrupções de relógio
+void so_define_tau(so_t *self, int tau);
+
+// escolhe o algoritmo de substituição de páginas (o padrão é WSClock)
+// retorna false se não foi possível
+bool so_define_subst(so_t *self, subst_alg_t alg);
+
+// mostra no console os números de faltas de página, de gravações de
+//   páginas no disco, de cópias de páginas compartilhadas feitas na
+//   primeira escrita e de páginas sem dados zeradas no primeiro acesso,
+//   com o nome do algoritmo de substituição usado
+void so_imprime_estatisticas(so_t *self);
+
 // Chamadas de sistema
 // Uma chamada de sistema é realizada colocando a identificação da
 //   chamada (um dos valores abaixo) no registrador A e executando a
@@ -76,4 +92,13 @@ void so_destroi(so_t *self);
 // retorna sem bloquear, com erro, se não existir processo com esse pid
 #define SO_ESPERA_PROC 9
 
+// cria um processo que é uma cópia do processo chamador: executa o mesmo
+//   programa, a partir da instrução seguinte à chamada, com os mesmos
+//   valores nos registradores e na memória
+// a memória não é copiada na criação; as páginas são compartilhadas pelos
+//   dois processos, e cada uma só é copiada quando um deles a altera
+// retorna em A: pid do processo criado para o chamador, 0 para o processo
+//   criado, ou código de erro negativo
+#define SO_FORK        10
+
 #endif // SO_H
@@ -0,0 +1,304 @@
+#include "subst.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+// estado de um quadro
+typedef struct {
+  bool ocupado;
+  bool referenciada;  // acesso percebido desde que o algoritmo olhou o quadro
+  bool acessou;       // acesso percebido no intervalo de tempo atual
+  unsigned idade;     // contador de envelhecimento (LRU)
+  int t_acesso;       // tempo virtual do último acesso percebido (WSClock)
+  int ant, prox;      // vizinhos na fila de quadros ocupados, -1 se não tem
+} quadro_t;
+
+struct subst_t {
+  subst_alg_t alg;
+  subst_ops_t ops;
+  void *arg;
+  int n_quadros;
+  quadro_t *quadros;
+  // fila dos quadros ocupados, na ordem em que foram ocupados (-1 se vazia)
+  int primeiro;
+  int ultimo;
+  // ponteiro do relógio do WSClock
+  int ponteiro;
+  int tau;
+};
+
+// o que muda de um algoritmo para outro
+// 'acessou' e 'tictac' podem ser NULL, se o algoritmo não usa a informação
+typedef struct {
+  char *nome;
+  void (*acessou)(subst_t *self, int quadro);
+  void (*tictac)(subst_t *self);
+  int (*escolhe)(subst_t *self);
+} politica_t;
+
+
+// fila de quadros ocupados
+
+static void fila_insere(subst_t *self, int quadro)
+{
+  quadro_t *q = &self->quadros[quadro];
+  q->ant = self->ultimo;
+  q->prox = -1;
+  if (self->ultimo == -1) {
+    self->primeiro = quadro;
+  } else {
+    self->quadros[self->ultimo].prox = quadro;
+  }
+  self->ultimo = quadro;
+}
+
+static void fila_remove(subst_t *self, int quadro)
+{
+  quadro_t *q = &self->quadros[quadro];
+  if (q->ant == -1) {
+    self->primeiro = q->prox;
+  } else {
+    self->quadros[q->ant].prox = q->prox;
+  }
+  if (q->prox == -1) {
+    self->ultimo = q->ant;
+  } else {
+    self->quadros[q->prox].ant = q->ant;
+  }
+}
+
+// retorna se a página no quadro foi acessada desde a última vez que o
+//   algoritmo olhou, e esquece esse acesso
+static bool foi_referenciada(subst_t *self, int quadro)
+{
+  quadro_t *q = &self->quadros[quadro];
+  bool ref = q->referenciada;
+  q->referenciada = false;
+  if (self->ops.bit_acesso(self->arg, quadro)) {
+    self->ops.zera_bit_acesso(self->arg, quadro);
+    ref = true;
+  }
+  return ref;
+}
+
+
+// FIFO
+
+static int fifo_escolhe(subst_t *self)
+{
+  return self->primeiro;
+}
+
+
+// segunda chance
+// percorre a fila a partir do mais antigo; o que foi referenciado perde
+//   a referência e vai para o fim da fila
+
+static void sc_acessou(subst_t *self, int quadro)
+{
+  self->quadros[quadro].referenciada = true;
+}
+
+static int sc_escolhe(subst_t *self)
+{
+  while (self->primeiro != -1) {
+    int quadro = self->primeiro;
+    if (!foi_referenciada(self, quadro)) return quadro;
+    fila_remove(self, quadro);
+    fila_insere(self, quadro);
+  }
+  return -1;
+}
+
+
+// LRU aproximado por envelhecimento
+// a cada unidade de tempo, a idade de cada quadro é deslocada um bit para
+//   a direita, e o bit mais significativo recebe 1 se a página foi acessada
+//   no intervalo; o quadro com menor idade é o usado há mais tempo
+// uma página com o bit de acesso ligado foi usada depois do último
+//   intervalo, e não é escolhida se tiver outra
+
+static void lru_acessou(subst_t *self, int quadro)
+{
+  self->quadros[quadro].acessou = true;
+}
+
+static void lru_tictac(subst_t *self)
+{
+  // só os ocupados, que estão na fila
+  for (int quadro = self->primeiro; quadro != -1;
+       quadro = self->quadros[quadro].prox) {
+    quadro_t *q = &self->quadros[quadro];
+    q->idade >>= 1;
+    if (q->acessou) q->idade |= ~(UINT_MAX >> 1);
+    q->acessou = false;
+  }
+}
+
+static int lru_escolhe(subst_t *self)
+{
+  int escolhido = -1;
+  unsigned menor = UINT_MAX;
+  // percorre na ordem de carga, para desempatar pelo mais antigo
+  for (int quadro = self->primeiro; quadro != -1;
+       quadro = self->quadros[quadro].prox) {
+    unsigned idade = self->quadros[quadro].idade;
+    if (self->ops.bit_acesso(self->arg, quadro)) idade = UINT_MAX;
+    if (escolhido == -1 || idade < menor) {
+      escolhido = quadro;
+      menor = idade;
+    }
+  }
+  return escolhido;
+}
+
+
+// WSClock (ver Assuntos/wsclock.md)
+// percorre os quadros a partir do ponteiro do relógio procurando uma página
+//   fora do conjunto de trabalho e não alterada; as alteradas fora do
+//   conjunto de trabalho são gravadas no caminho, e podem ser escolhidas
+//   na segunda volta
+// se todas estiverem no conjunto de trabalho, escolhe a de acesso mais
+//   antigo, em relação ao tempo virtual do dono de cada uma (o tempo
+//   virtual de processos diferentes não é comparável)
+
+static void ws_acessou(subst_t *self, int quadro)
+{
+  self->quadros[quadro].t_acesso = self->ops.tempo_virtual(self->arg, quadro);
+}
+
+static int ws_escolhe(subst_t *self)
+{
+  int mais_antigo = -1;
+  int maior_idade = 0;
+  for (int i = 0; i < 2 * self->n_quadros; i++) {
+    int quadro = self->ponteiro;
+    self->ponteiro = (self->ponteiro + 1) % self->n_quadros;
+    quadro_t *q = &self->quadros[quadro];
+    if (!q->ocupado) continue;
+    int agora = self->ops.tempo_virtual(self->arg, quadro);
+    if (foi_referenciada(self, quadro)) {
+      q->t_acesso = agora;
+    } else if (agora - q->t_acesso > self->tau) {
+      if (!self->ops.bit_alteracao(self->arg, quadro)) {
+        return quadro;
+      }
+      self->ops.grava(self->arg, quadro);
+    }
+    if (mais_antigo == -1 || agora - q->t_acesso > maior_idade) {
+      mais_antigo = quadro;
+      maior_idade = agora - q->t_acesso;
+    }
+  }
+  // as duas voltas deixaram o ponteiro onde começou; ele tem que passar do
+  //   quadro escolhido, senão a próxima escolha seria a mesma
+  if (mais_antigo != -1) {
+    self->ponteiro = (mais_antigo + 1) % self->n_quadros;
+  }
+  return mais_antigo;
+}
+
+
+static const politica_t politicas[N_SUBST] = {
+  [SUBST_FIFO]           = { "fifo",    NULL,        NULL,       fifo_escolhe },
+  [SUBST_SEGUNDA_CHANCE] = { "sc",      sc_acessou,  NULL,       sc_escolhe   },
+  [SUBST_LRU]            = { "lru",     lru_acessou, lru_tictac, lru_escolhe  },
+  [SUBST_WSCLOCK]        = { "wsclock", ws_acessou,  NULL,       ws_escolhe   },
+};
+
+char *subst_nome(subst_alg_t alg)
+{
+  if (alg < 0 || alg >= N_SUBST) return "DESCONHECIDO";
+  return politicas[alg].nome;
+}
+
+bool subst_alg_de_nome(char *nome, subst_alg_t *palg)
+{
+  for (subst_alg_t alg = 0; alg < N_SUBST; alg++) {
+    if (strcmp(nome, politicas[alg].nome) == 0) {
+      *palg = alg;
+      return true;
+    }
+  }
+  return false;
+}
+
+subst_t *subst_cria(subst_alg_t alg, int n_quadros,
+                    const subst_ops_t *ops, void *arg)
+{
+  if (alg < 0 || alg >= N_SUBST || n_quadros < 1) return NULL;
+  subst_t *self = malloc(sizeof(*self));
+  if (self == NULL) return NULL;
+  // todos começam desocupados (false); com calloc, o espaço dos quadros
+  //   que nunca forem ocupados não chega a ser usado
+  self->quadros = calloc(n_quadros, sizeof(quadro_t));
+  if (self->quadros == NULL) {
+    free(self);
+    return NULL;
+  }
+  self->alg = alg;
+  self->ops = *ops;
+  self->arg = arg;
+  self->n_quadros = n_quadros;
+  self->primeiro = -1;
+  self->ultimo = -1;
+  self->ponteiro = 0;
+  self->tau = 0;
+  return self;
+}
+
+void subst_destroi(subst_t *self)
+{
+  free(self->quadros);
+  free(self);
+}
+
+subst_alg_t subst_alg(subst_t *self)
+{
+  return self->alg;
+}
+
+void subst_define_tau(subst_t *self, int tau)
+{
+  self->tau = tau;
+}
+
+void subst_carregou(subst_t *self, int quadro)
+{
+  quadro_t *q = &self->quadros[quadro];
+  if (q->ocupado) return;
+  q->ocupado = true;
+  q->referenciada = false;
+  q->acessou = false;
+  q->idade = 0;
+  q->t_acesso = self->ops.tempo_virtual(self->arg, quadro);
+  fila_insere(self, quadro);
+}
+
+void subst_liberou(subst_t *self, int quadro)
+{
+  quadro_t *q = &self->quadros[quadro];
+  if (!q->ocupado) return;
+  q->ocupado = false;
+  fila_remove(self, quadro);
+}
+
+void subst_acessou(subst_t *self, int quadro)
+{
+  if (!self->quadros[quadro].ocupado) return;
+  if (politicas[self->alg].acessou != NULL) {
+    politicas[self->alg].acessou(self, quadro);
+  }
+}
+
+void subst_tictac(subst_t *self)
+{
+  if (politicas[self->alg].tictac != NULL) {
+    politicas[self->alg].tictac(self);
+  }
+}
+
+int subst_escolhe(subst_t *self)
+{
+  return politicas[self->alg].escolhe(self);
+}
@@ -0,0 +1,88 @@
+#ifndef SUBST_H
+#define SUBST_H
+
+// substituição de páginas
+// escolhe o quadro da memória principal que vai ser liberado quando o SO
+//   precisa de um quadro e não tem nenhum livre
+// o SO mantém a tabela de quadros (qual página está em cada um) e avisa
+//   este módulo quando um quadro é ocupado ou liberado, e do que percebe
+//   sobre os acessos às páginas; os quadros são identificados por um
+//   número entre 0 e o número de quadros menos 1
+// o algoritmo obtém o que precisa saber sobre a página que está em um
+//   quadro através de funções fornecidas pelo SO (ver subst_ops_t)
+
+#include <stdbool.h>
+
+// os algoritmos de substituição disponíveis
+typedef enum {
+  SUBST_FIFO,           // a página há mais tempo na memória
+  SUBST_SEGUNDA_CHANCE, // FIFO, mas pula (e reinsere) as acessadas
+  SUBST_LRU,            // aproximação de LRU por envelhecimento
+  SUBST_WSCLOCK,        // conjunto de trabalho (ver Assuntos/wsclock.md)
+  N_SUBST               // número de algoritmos
+} subst_alg_t;
+
+// retorna o nome do algoritmo
+char *subst_nome(subst_alg_t alg);
+
+// coloca em '*palg' o algoritmo com o nome 'nome' (o mesmo de subst_nome)
+// retorna false se não existir algoritmo com esse nome
+bool subst_alg_de_nome(char *nome, subst_alg_t *palg);
+
+// funções fornecidas pelo SO para o algoritmo consultar e alterar a página
+//   que está em um quadro
+// todas recebem o argumento fornecido em subst_cria e o número do quadro
+typedef struct {
+  // bit de acesso da página, na tabela de páginas do seu dono
+  bool (*bit_acesso)(void *arg, int quadro);
+  void (*zera_bit_acesso)(void *arg, int quadro);
+  // bit de alteração da página
+  bool (*bit_alteracao)(void *arg, int quadro);
+  // grava a página na memória secundária; ela continua no quadro, mas
+  //   passa a não estar alterada
+  void (*grava)(void *arg, int quadro);
+  // tempo virtual atual do dono da página
+  int (*tempo_virtual)(void *arg, int quadro);
+} subst_ops_t;
+
+// tipo opaco que representa o estado de um algoritmo de substituição
+typedef struct subst_t subst_t;
+
+// cria o estado para o algoritmo 'alg' escolher entre 'n_quadros' quadros
+// todos os quadros começam livres
+// retorna NULL em caso de erro
+subst_t *subst_cria(subst_alg_t alg, int n_quadros,
+                    const subst_ops_t *ops, void *arg);
+
+// destrói o estado do algoritmo
+void subst_destroi(subst_t *self);
+
+// retorna o algoritmo usado
+subst_alg_t subst_alg(subst_t *self);
+
+// define o tamanho do conjunto de trabalho (WSClock), em tempo virtual
+void subst_define_tau(subst_t *self, int tau);
+
+// informa que uma página foi colocada no quadro (livre)
+void subst_carregou(subst_t *self, int quadro);
+
+// informa que o quadro foi liberado (a página que estava nele não está
+//   mais na memória principal)
+void subst_liberou(subst_t *self, int quadro);
+
+// informa que o SO percebeu que a página no quadro foi acessada (o bit de
+//   acesso estava ligado e foi zerado pelo SO)
+void subst_acessou(subst_t *self, int quadro);
+
+// informa que passou uma unidade de tempo (interrupção do relógio)
+// deve ser chamada depois de subst_acessou para as páginas acessadas
+//   nesse intervalo
+void subst_tictac(subst_t *self);
+
+// escolhe um quadro ocupado para ser liberado
+// a página do quadro escolhido pode estar alterada; quem chama deve
+//   gravá-la antes de reusar o quadro
+// retorna -1 se não tem quadro ocupado
+int subst_escolhe(subst_t *self);
+
+#endif // SUBST_H
@@ -3,15 +3,20 @@
 #include <stdlib.h>
 #include <assert.h>
 
+// descritor de página, empacotado em uma palavra
 typedef struct {
-  int quadro;
-  bool acessada;
-  bool alterada;
+  signed int quadro : 28;    // -1 se a página não está em memória (ver
+                             //   TABPAG_MAX_QUADRO)
+  unsigned int acessada : 1;
+  unsigned int alterada : 1;
+  unsigned int permissoes : 2;  // combinação de perm_t
 } descritor_t;
 
 struct tabpag_t {
   descritor_t *tabela;
   int tam_tab;
+  tabpag_observador_t observador;
+  void *arg_observador;
 };
 
 tabpag_t *tabpag_cria(void)
@@ -20,11 +25,16 @@ tabpag_t *tabpag_cria(void)
   if (self == NULL) return self;
   self->tabela = NULL;
   self->tam_tab = 0;
+  self->observador = NULL;
+  self->arg_observador = NULL;
   return self;
 }
 
 void tabpag_destroi(tabpag_t *self)
 {
+  if (self->observador != NULL) {
+    self->observador(self->arg_observador, -1);
+  }
   if (self->tabela != NULL) free(self->tabela);
   free(self);
 }
@@ -64,18 +74,43 @@ static void tabpag__insere_pagina(tabpag_t *self, int pagina)
   }
 }
 
+static void tabpag__avisa(tabpag_t *self, int pagina)
+{
+  if (self->observador != NULL) {
+    self->observador(self->arg_observador, pagina);
+  }
+}
+
 void tabpag_define_quadro(tabpag_t *self, int pagina, int quadro)
 {
   if (quadro == -1) {
     tabpag__remove_pagina(self, pagina);
   } else {
+    assert(quadro >= 0 && quadro <= TABPAG_MAX_QUADRO);
     tabpag__insere_pagina(self, pagina);
     self->tabela[pagina].quadro = quadro;
     self->tabela[pagina].acessada = false;
     self->tabela[pagina].alterada = false;
+    self->tabela[pagina].permissoes = PERM_TODAS;
+  }
+  tabpag__avisa(self, pagina);
+}
+
+void tabpag_define_permissoes(tabpag_t *self, int pagina, int permissoes)
+{
+  if (pagina < self->tam_tab && self->tabela[pagina].quadro != -1) {
+    self->tabela[pagina].permissoes = permissoes;
+    tabpag__avisa(self, pagina);
   }
 }
 
+void tabpag_define_observador(tabpag_t *self, tabpag_observador_t func,
+                              void *arg)
+{
+  self->observador = func;
+  self->arg_observador = arg;
+}
+
 void tabpag_marca_bit_acesso(tabpag_t *self, int pagina, bool alteracao)
 {
   if (pagina < self->tam_tab) {
@@ -90,7 +125,31 @@ void tabpag_zera_bit_acesso(tabpag_t *self, int pagina)
 {
   if (pagina < self->tam_tab) {
     self->tabela[pagina].acessada = false;
+    tabpag__avisa(self, pagina);
+  }
+}
+
+void tabpag_zera_bits(tabpag_t *self, int pagina)
+{
+  if (pagina < self->tam_tab) {
+    self->tabela[pagina].acessada = false;
+    self->tabela[pagina].alterada = false;
+    tabpag__avisa(self, pagina);
+  }
+}
+
+int tabpag_coleta_e_zera_bits(tabpag_t *self, int paginas[], int max)
+{
+  int n = 0;
+  for (int pagina = 0; pagina < self->tam_tab && n < max; pagina++) {
+    descritor_t *desc = &self->tabela[pagina];
+    if (desc->quadro != -1 && desc->acessada) {
+      desc->acessada = false;
+      paginas[n++] = pagina;
+      tabpag__avisa(self, pagina);
+    }
   }
+  return n;
 }
 
 bool tabpag_bit_acesso(tabpag_t *self, int pagina)
@@ -109,13 +168,13 @@ bool tabpag_bit_alteracao(tabpag_t *self, int pagina)
   return false;
 }
 
-err_t tabpag_traduz(tabpag_t *self, int endvirt, int *pendfis)
+err_t tabpag_traduz(tabpag_t *self, int pagina, int *pquadro,
+                    int *ppermissoes)
 {
-  int pagina = endvirt / TAM_PAGINA;
-  if (pagina >= self->tam_tab) return ERR_END_INV;
+  if (pagina < 0 || pagina >= self->tam_tab) return ERR_END_INV;
   int quadro = self->tabela[pagina].quadro;
   if (quadro == -1) return ERR_PAG_AUSENTE;
-  int deslocamento = endvirt % TAM_PAGINA;
-  *pendfis = quadro * TAM_PAGINA + deslocamento;
+  *pquadro = quadro;
+  if (ppermissoes != NULL) *ppermissoes = self->tabela[pagina].permissoes;
   return ERR_OK;
 }
@@ -3,18 +3,30 @@
 
 // tabela de páginas, para implementação de paginação
 // estrutura auxiliar para a MMU
-// realiza a tradução de endereços virtuais do espaço de endereçamento
-//   de um processo em endereços físicos da memória principal
+// realiza a tradução de páginas do espaço de endereçamento de um processo
+//   em quadros da memória principal
+// não conhece o tamanho das páginas: a separação de um endereço em página
+//   e deslocamento é feita pela MMU (ver mmu_tam_pagina)
 
 #include "err.h"
 #include <stdbool.h>
 
-// tamanho de uma página, em palavras de memória
-#define TAM_PAGINA 10
-
 // tipo opaco que representa a tabela de páginas
 typedef struct tabpag_t tabpag_t;
 
+// permissões de acesso a uma página mapeada, que podem ser combinadas
+//   com '|'; a leitura é sempre permitida
+typedef enum {
+  PERM_ESCRITA  = 1,  // a página pode ser alterada
+  PERM_EXECUCAO = 2,  // instruções na página podem ser executadas
+  PERM_TODAS    = PERM_ESCRITA | PERM_EXECUCAO,
+} perm_t;
+
+// tipo da função chamada quando a tradução de uma página é alterada
+// recebe o argumento registrado junto com a função e o número da página,
+//   ou -1 se a tabela vai ser destruída
+typedef void (*tabpag_observador_t)(void *arg, int pagina);
+
 // cria uma tabela de páginas
 // retorna um ponteiro para um descritor, que deverá ser usado em todas
 //   as operações nessa tabela
@@ -22,15 +34,38 @@ typedef struct tabpag_t tabpag_t;
 tabpag_t *tabpag_cria(void);
 
 // destrói uma tabela de páginas
+// avisa o observador da tabela (se houver), com a página -1
 // nenhuma outra operação pode ser realizada na tabela após esta chamada
 void tabpag_destroi(tabpag_t *self);
 
+// maior número de quadro que pode estar em uma tradução (o descritor de
+//   página guarda o quadro em 28 bits, com sinal)
+#define TABPAG_MAX_QUADRO ((1 << 27) - 1)
+
 // define a tradução da página 'pagina' deve resultar no quadro 'quadro'
+//   (entre 0 e TABPAG_MAX_QUADRO)
 // se 'quadro' for -1, indica que a tradução não é possível, resultando em
 //   ERR_PAG_AUSENTE
-// os bits de acesso e alteração para essa página são zerados
+// os bits de acesso e alteração para essa página são zerados, e ela passa
+//   a ter todas as permissões (ver tabpag_define_permissoes)
+// avisa o observador da tabela (se houver) da alteração
 void tabpag_define_quadro(tabpag_t *self, int pagina, int quadro);
 
+// define as permissões da página mapeada 'pagina' (combinação de perm_t,
+//   ou 0 para somente leitura); um acesso que a página não permite
+//   resulta em ERR_PROTECAO (é assim que o SO percebe a primeira escrita
+//   em uma página compartilhada, para fazer uma cópia dela)
+// não faz nada se a página não estiver mapeada em algum quadro
+// avisa o observador da tabela (se houver) da alteração
+void tabpag_define_permissoes(tabpag_t *self, int pagina, int permissoes);
+
+// define a função a ser chamada cada vez que a tradução de uma página for
+//   alterada ou seu bit de acesso for zerado, para que quem guarda cópias
+//   dessa informação (a TLB da MMU) possa descartá-las
+// só existe um observador; se 'func' for NULL, não chama ninguém
+void tabpag_define_observador(tabpag_t *self, tabpag_observador_t func,
+                              void *arg);
+
 // marca o bit de acesso à página; se alteracao for true, marca também o
 //   bit de alteração
 // não faz nada se a página não estiver mapeada em algum quadro
@@ -38,8 +73,23 @@ void tabpag_marca_bit_acesso(tabpag_t *self, int pagina, bool alteracao);
 
 // zera o bit de acesso à página; não afeta o bit de alteração
 // não faz nada se a página não estiver mapeada em algum quadro
+// avisa o observador, para que o próximo acesso volte a marcar o bit
 void tabpag_zera_bit_acesso(tabpag_t *self, int pagina);
 
+// zera os bits de acesso e alteração da página, sem alterar sua tradução
+// é o que acontece quando a página é gravada na memória secundária
+// avisa o observador, para que o próximo acesso volte a marcar os bits
+void tabpag_zera_bits(tabpag_t *self, int pagina);
+
+// coloca em 'paginas' os números das páginas mapeadas que estão com o bit
+//   de acesso ligado (no máximo 'max' delas, em ordem crescente), e zera
+//   esse bit nelas, avisando o observador
+// retorna o número de páginas colocadas no vetor; se for 'max', pode ter
+//   sobrado página com o bit ligado, e a função pode ser chamada de novo
+// é a operação feita a cada interrupção do relógio por algoritmos de
+//   substituição que usam o bit de acesso (envelhecimento, WSClock)
+int tabpag_coleta_e_zera_bits(tabpag_t *self, int paginas[], int max);
+
 // retorna o valor do bit de acesso à página
 // retorna false se a página não estiver mapeada em algum quadro
 bool tabpag_bit_acesso(tabpag_t *self, int pagina);
@@ -48,11 +98,15 @@ bool tabpag_bit_acesso(tabpag_t *self, int pagina);
 // retorna false se a página não estiver mapeada em algum quadro
 bool tabpag_bit_alteracao(tabpag_t *self, int pagina);
 
-// traduz o endereço virtual 'endvirt'; coloca o endereço físico correspondente
-//   na posição apontada por 'pendfis'
-// retorna erro (e não altera '*pendfis') se a tradução não for possível:
-//   ERR_END_INV - página não existente na tabela de páginas
+// traduz a página 'pagina'; coloca o quadro correspondente na posição
+//   apontada por 'pquadro' e as permissões da página (ver
+//   tabpag_define_permissoes) na apontada por 'ppermissoes', se não for NULL
+// a tabela não verifica as permissões, quem acessa a página (a MMU) é que
+//   sabe o tipo de acesso
+// retorna erro (e não altera '*pquadro') se a tradução não for possível:
+//   ERR_END_INV - página negativa ou não existente na tabela de páginas
 //   ERR_PAG_AUSENTE - página marcada como ausente na tabela de páginas
-err_t tabpag_traduz(tabpag_t *self, int endvirt, int *pendfis);
+err_t tabpag_traduz(tabpag_t *self, int pagina, int *pquadro,
+                    int *ppermissoes);
 
 #endif // TABPAG_H